@@ -0,0 +1,148 @@
+#include "NetworkUtils/Checksum.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Проверка и бенчмарк реализаций контрольной суммы Интернета
+ *
+ * Сначала сверяет каждую поддерживаемую процессором реализацию с эталоном
+ * RFC 1071 (побайтовая сборка слов в сетевом порядке) на всех длинах до 1100 байт
+ * и всех смещениях начала в пределах строки кэша, на случайных данных и на данных
+ * из одних 0xFF (максимум переносов), а также при суммировании по частям.
+ * Затем измеряет пропускную способность на типичных размерах кадров.
+ * Запуск: checksum_bench [итераций на размер]
+ * Код возврата 1, если хотя бы одна реализация разошлась с эталоном.
+ */
+
+namespace {
+
+    using utils::ChecksumKernel;
+
+    const ChecksumKernel kKernels[] = {
+            ChecksumKernel::Scalar, ChecksumKernel::Sse2, ChecksumKernel::Avx2, ChecksumKernel::Avx512};
+
+    /**
+     * @brief Эталонная контрольная сумма RFC 1071 в порядке байт процессора
+     */
+    uint16_t referenceChecksum(const uint8_t* data, size_t length) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i + 1 < length; i += 2) {
+            sum += uint32_t(data[i]) << 8 | data[i + 1];
+        }
+        if (length & 1) {
+            sum += uint32_t(data[length - 1]) << 8;
+        }
+        while (sum >> 16) {
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+        return htons(static_cast<uint16_t>(~sum));
+    }
+
+    /**
+     * @brief Сверяет реализацию с эталоном, возвращает число расхождений
+     */
+    size_t verifyKernel(ChecksumKernel kernel, const std::vector<uint8_t>& buffer) {
+        constexpr size_t kMaxLength = 1100;
+        constexpr size_t kMaxOffset = 64;
+        size_t mismatches = 0;
+
+        for (size_t offset = 0; offset < kMaxOffset; ++offset) {
+            const uint8_t* data = buffer.data() + offset;
+            for (size_t length = 0; length <= kMaxLength; ++length) {
+                uint16_t expected = referenceChecksum(data, length);
+                uint16_t actual = utils::checksumFinish(utils::checksumPartial(kernel, data, length));
+                if (actual != expected) {
+                    if (mismatches++ < 5) {
+                        std::cerr << utils::checksumKernelName(kernel) << ": offset " << offset
+                                  << " length " << length << " expected 0x" << std::hex << expected
+                                  << " got 0x" << actual << std::dec << std::endl;
+                    }
+                }
+
+                // Сумма по частям: первая часть чётной длины, затем остаток
+                size_t split = (length / 3) & ~size_t(1);
+                uint32_t partial = utils::checksumPartial(kernel, data, split);
+                partial = utils::checksumPartial(kernel, data + split, length - split, partial);
+                if (utils::checksumFinish(partial) != expected && mismatches++ < 5) {
+                    std::cerr << utils::checksumKernelName(kernel) << ": split " << split
+                              << " length " << length << " mismatch" << std::endl;
+                }
+            }
+        }
+
+        // Длинный буфер: проверяет перенос векторных дорожек в 64-битный итог
+        uint16_t expected = referenceChecksum(buffer.data(), buffer.size());
+        if (utils::checksumFinish(utils::checksumPartial(kernel, buffer.data(), buffer.size())) != expected) {
+            std::cerr << utils::checksumKernelName(kernel) << ": long buffer mismatch" << std::endl;
+            ++mismatches;
+        }
+        return mismatches;
+    }
+
+    /**
+     * @brief Измеряет пропускную способность реализации, Гбит/с
+     */
+    double measure(ChecksumKernel kernel, const uint8_t* data, size_t length, size_t iterations) {
+        uint32_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            // Зависимость по sink не даёт компилятору выбросить вызовы
+            sink = utils::checksumPartial(kernel, data, length, sink & 1);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (sink == UINT32_MAX) std::cout << "";
+        return double(length) * double(iterations) * 8.0 / seconds / 1e9;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    std::vector<ChecksumKernel> kernels;
+    for (ChecksumKernel kernel : kKernels) {
+        if (utils::checksumKernelSupported(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+    std::cout << "Active kernel: " << utils::checksumKernelName(utils::activeChecksumKernel()) << std::endl;
+
+    // Проверка на случайных данных и на данных из одних 0xFF
+    std::mt19937 rng(42);
+    std::vector<uint8_t> randomData(1u << 20);
+    for (auto& byte : randomData) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    std::vector<uint8_t> onesData(1u << 20, 0xFF);
+
+    size_t mismatches = 0;
+    for (ChecksumKernel kernel : kernels) {
+        size_t bad = verifyKernel(kernel, randomData) + verifyKernel(kernel, onesData);
+        std::cout << "Verify " << std::left << std::setw(8) << utils::checksumKernelName(kernel)
+                  << (bad ? "FAILED" : "ok") << std::endl;
+        mismatches += bad;
+    }
+
+    const size_t sizes[] = {64, 128, 256, 512, 1500, 4096, 9000};
+    std::cout << "\n" << std::left << std::setw(8) << "Bytes";
+    for (ChecksumKernel kernel : kernels) {
+        std::cout << std::right << std::setw(12) << utils::checksumKernelName(kernel);
+    }
+    std::cout << "   (Gbit/s)" << std::endl;
+
+    for (size_t size : sizes) {
+        std::cout << std::left << std::setw(8) << size << std::fixed << std::setprecision(1);
+        for (ChecksumKernel kernel : kernels) {
+            // Смещение 14 — начало IP-заголовка в кадре Ethernet
+            std::cout << std::right << std::setw(12) << measure(kernel, randomData.data() + 14, size, iterations);
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    return mismatches ? 1 : 0;
+}
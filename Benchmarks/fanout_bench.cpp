@@ -0,0 +1,219 @@
+#include "CommutationTable.h"
+#include "PacketRing.h"
+#include <linux/if_ether.h>
+#include <array>
+#include <random>
+
+/**
+ * @brief Бенчмарк масштабирования приёма одного порта через PACKET_FANOUT
+ *
+ * Поток-отправитель шлёт кадры UDP из множества потоков (разные MAC, адреса и порты)
+ * в интерфейс tx_iface, а 1, 2, 4, 8 ... потоков захвата принимают их на rx_iface
+ * из колец одной группы PACKET_FANOUT (режим hash). Как и потоки коммутатора,
+ * потоки захвата обучают общую таблицу коммутации, ищут в ней порт назначения
+ * и обновляют статистику. Для каждого числа потоков выводится скорость приёма
+ * и доли кадров самого и наименее загруженного потока.
+ *
+ * Нужны права root и два связанных интерфейса (например, пара veth).
+ * Запуск: fanout_bench <rx_iface> <tx_iface> [секунд на замер] [максимум потоков]
+ */
+
+namespace {
+
+    constexpr size_t kFlows = 4096;
+    constexpr size_t kFrameSize = 64;
+    constexpr size_t kSendBatch = 64;
+
+    /**
+     * @struct alignas(64) WorkerCounter
+     * @brief Счётчик кадров потока захвата в своей строке кэша
+     */
+    struct alignas(64) WorkerCounter {
+        std::atomic<uint64_t> frames{0};
+    };
+
+    /**
+     * @brief Строит кадры UDP для kFlows разных потоков
+     */
+    std::vector<std::array<u_char, kFrameSize>> makeFrames() {
+        std::mt19937 rng(1);
+        std::vector<std::array<u_char, kFrameSize>> frames(kFlows);
+        for (auto& frame : frames) {
+            frame.fill(0);
+            auto* eth = reinterpret_cast<struct ether_header*>(frame.data());
+            const u_char dst[6] = {0x02, 0, 0, 0, 0, 0xFE};
+            u_char src[6] = {0x02, 0, 0, 0, 0, 0};
+            uint32_t host = rng();
+            memcpy(src + 2, &host, 4);
+            memcpy(eth->ether_dhost, dst, 6);
+            memcpy(eth->ether_shost, src, 6);
+            eth->ether_type = htons(ETHERTYPE_IP);
+
+            auto* ip = reinterpret_cast<struct ip*>(frame.data() + sizeof(struct ether_header));
+            ip->ip_v = 4;
+            ip->ip_hl = 5;
+            ip->ip_len = htons(kFrameSize - sizeof(struct ether_header));
+            ip->ip_ttl = 64;
+            ip->ip_p = IPPROTO_UDP;
+            ip->ip_src.s_addr = htonl(0x0A000000 | (rng() & 0xFFFFFF));
+            ip->ip_dst.s_addr = htonl(0xC0A80000 | (rng() & 0xFFFF));
+
+            auto* udp = reinterpret_cast<struct udphdr*>(frame.data() + sizeof(struct ether_header) + 20);
+            udp->uh_sport = htons(uint16_t(rng()));
+            udp->uh_dport = htons(uint16_t(rng()));
+            udp->uh_ulen = htons(kFrameSize - sizeof(struct ether_header) - 20);
+        }
+        return frames;
+    }
+
+    int openSender(const std::string& iface) {
+        int fd = socket(AF_PACKET, SOCK_RAW, 0);
+        if (fd < 0) {
+            throw std::runtime_error("AF_PACKET socket failed: " + std::string(strerror(errno)));
+        }
+        struct sockaddr_ll addr{};
+        addr.sll_family = AF_PACKET;
+        addr.sll_ifindex = static_cast<int>(if_nametoindex(iface.c_str()));
+        if (addr.sll_ifindex == 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            throw std::runtime_error("bind to " + iface + " failed: " + std::string(strerror(errno)));
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Шлёт кадры по кругу, пока не сброшен running
+     */
+    void sendLoop(int fd, const std::vector<std::array<u_char, kFrameSize>>& frames,
+                  const std::atomic<bool>& running) {
+        std::vector<iovec> iov(kSendBatch);
+        std::vector<mmsghdr> messages(kSendBatch);
+        size_t next = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            for (size_t i = 0; i < kSendBatch; ++i) {
+                iov[i] = {const_cast<u_char*>(frames[next].data()), kFrameSize};
+                messages[i] = {};
+                messages[i].msg_hdr.msg_iov = &iov[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+                next = (next + 1) % frames.size();
+            }
+            sendmmsg(fd, messages.data(), kSendBatch, 0);
+        }
+    }
+
+    /**
+     * @brief Замер для заданного числа потоков захвата
+     * @return Принято кадров в секунду
+     */
+    double runRound(const std::string& rxIface, int txFd, const std::vector<std::array<u_char, kFrameSize>>& frames,
+                    size_t workers, double seconds, int fanoutGroup) {
+        PacketRing::Options options;
+        options.blockSize = 1u << 20;
+        options.blockCount = 16;
+        options.fanoutGroup = fanoutGroup;
+
+        std::vector<std::unique_ptr<PacketRing>> rings;
+        for (size_t i = 0; i < workers; ++i) {
+            rings.push_back(std::make_unique<PacketRing>(rxIface, options));
+        }
+
+        CommutationTable table(60);
+        std::vector<WorkerCounter> counters(workers);
+        std::atomic<bool> running{true};
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([&, i] {
+                PacketRing& ring = *rings[i];
+                WorkerCounter& counter = counters[i];
+                while (running.load(std::memory_order_relaxed)) {
+                    ring.poll(10, [&](u_char* packet, uint32_t caplen, uint32_t) {
+                        auto start = std::chrono::steady_clock::now();
+                        auto* eth = reinterpret_cast<const struct ether_header*>(packet);
+                        if (caplen >= sizeof(struct ether_header)) {
+                            table.updateEntry(eth->ether_shost, 0);
+                            table.getPortForMac(eth->ether_dhost);
+                        }
+                        counter.frames.store(counter.frames.load(std::memory_order_relaxed) + 1,
+                                             std::memory_order_relaxed);
+                        table.updateStats(0, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start).count());
+                    });
+                }
+            });
+        }
+        std::thread sender(sendLoop, txFd, std::cref(frames), std::cref(running));
+
+        // Прогрев, затем замер по разности счётчиков
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        std::vector<uint64_t> before(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            before[i] = counters[i].frames.load(std::memory_order_relaxed);
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t total = 0, minFrames = UINT64_MAX, maxFrames = 0;
+        for (size_t i = 0; i < workers; ++i) {
+            uint64_t frames = counters[i].frames.load(std::memory_order_relaxed) - before[i];
+            total += frames;
+            minFrames = std::min(minFrames, frames);
+            maxFrames = std::max(maxFrames, frames);
+        }
+
+        running = false;
+        sender.join();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        double pps = double(total) / elapsed;
+        std::cout << std::left << std::setw(10) << workers << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << pps << std::setprecision(1)
+                  << std::setw(12) << (total ? 100.0 * double(minFrames) / double(total) : 0.0)
+                  << std::setw(12) << (total ? 100.0 * double(maxFrames) / double(total) : 0.0)
+                  << std::setw(10) << table.size() << std::defaultfloat << std::endl;
+        return pps;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: fanout_bench <rx_iface> <tx_iface> [seconds] [max_workers]" << std::endl;
+        return 1;
+    }
+    std::string rxIface = argv[1];
+    std::string txIface = argv[2];
+    double seconds = argc > 3 ? std::stod(argv[3]) : 3.0;
+    size_t maxWorkers = argc > 4 ? std::stoul(argv[4]) : 8;
+
+    try {
+        int txFd = openSender(txIface);
+        auto frames = makeFrames();
+
+        std::cout << "CPUs: " << std::thread::hardware_concurrency() << ", flows: " << kFlows
+                  << ", frame: " << kFrameSize << " bytes" << std::endl
+                  << std::left << std::setw(10) << "Workers" << std::right << std::setw(14) << "Frames/s"
+                  << std::setw(12) << "Min share%" << std::setw(12) << "Max share%"
+                  << std::setw(10) << "MACs" << std::endl;
+
+        double base = 0;
+        for (size_t workers = 1, round = 0; workers <= maxWorkers; workers *= 2, ++round) {
+            double pps = runRound(rxIface, txFd, frames, workers, seconds,
+                                  int((getpid() * 16 + round) & 0xFFFF));
+            if (workers == 1) {
+                base = pps;
+            } else if (base > 0) {
+                std::cout << "          speedup x" << std::fixed << std::setprecision(2) << pps / base
+                          << std::defaultfloat << std::endl;
+            }
+        }
+        close(txFd);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
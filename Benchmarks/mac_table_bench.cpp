@@ -0,0 +1,190 @@
+#include "CommutationTable.h"
+#include "NetworkUtils/NetworkUtils.h"
+#include <array>
+#include <random>
+
+/**
+ * @brief Микробенчмарк поиска в таблице коммутации
+ *
+ * Сравнивает CommutationTable (открытая адресация, ключ uint64_t) с прежней
+ * реализацией на std::unordered_map<std::string, TableEntry>.
+ * Второй этап измеряет масштабирование: каждый поток изображает поток захвата
+ * своего порта и на каждый кадр выполняет обучение источника и поиск получателя.
+ * Запуск: mac_table_bench [число MAC-адресов] [число поисков] [максимум потоков]
+ */
+
+namespace {
+
+    /**
+     * @class LegacyMacTable
+     * @brief Прежняя реализация таблицы: строковый ключ и глобальный мьютекс
+     */
+    class LegacyMacTable {
+    public:
+        void updateEntry(const u_char* mac, int port) {
+            std::string macStr = utils::macToString(mac);
+            std::lock_guard<std::mutex> lock(mutex_);
+            macTable_[macStr] = {port, std::chrono::steady_clock::now()};
+        }
+
+        int getPortForMac(const u_char* mac) const {
+            std::string macStr = utils::macToString(mac);
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = macTable_.find(macStr);
+            return it != macTable_.end() ? it->second.port : -1;
+        }
+
+    private:
+        std::unordered_map<std::string, CommutationTable::TableEntry> macTable_;
+        mutable std::mutex mutex_;
+    };
+
+    /**
+     * @brief Генерирует набор случайных индивидуальных MAC-адресов
+     */
+    std::vector<std::array<u_char, 6>> makeMacs(size_t count, uint32_t seed) {
+        std::mt19937_64 rng(seed);
+        std::vector<std::array<u_char, 6>> macs(count);
+        for (auto& mac : macs) {
+            uint64_t v = rng();
+            utils::u64ToMac(v, mac.data());
+            mac[0] &= 0xFE; // Сбрасываем бит группового адреса
+        }
+        return macs;
+    }
+
+    /**
+     * @brief Измеряет скорость поиска (поисков в секунду)
+     * @param table Заполненная таблица
+     * @param probes Последовательность MAC-адресов для поиска
+     */
+    template <typename Table>
+    double measureLookups(const Table& table, const std::vector<const u_char*>& probes) {
+        auto start = std::chrono::steady_clock::now();
+        long checksum = 0;
+        for (const u_char* mac : probes) {
+            checksum += table.getPortForMac(mac);
+        }
+        auto end = std::chrono::steady_clock::now();
+        // Не даём компилятору выбросить цикл
+        if (checksum == -1) std::cout << "";
+        return probes.size() / std::chrono::duration<double>(end - start).count();
+    }
+
+    /**
+     * @brief Измеряет скорость обучения уже известных адресов (обновлений в секунду)
+     */
+    template <typename Table>
+    double measureLearns(Table& table, const std::vector<const u_char*>& probes) {
+        auto start = std::chrono::steady_clock::now();
+        for (const u_char* mac : probes) {
+            table.updateEntry(mac, mac[5] & 3);
+        }
+        auto end = std::chrono::steady_clock::now();
+        return probes.size() / std::chrono::duration<double>(end - start).count();
+    }
+
+    /**
+     * @brief Измеряет суммарную скорость пересылки кадров N потоками (кадров в секунду)
+     * @param table Общая таблица
+     * @param macs MAC-адреса хостов; хост i подключён к порту i % threads
+     * @param threads Число потоков (портов)
+     * @param framesPerThread Число кадров на поток
+     */
+    template <typename Table>
+    double measureForwarding(Table& table, const std::vector<std::array<u_char, 6>>& macs,
+                             int threads, size_t framesPerThread) {
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        std::vector<double> seconds(threads);
+
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937 rng(100 + t);
+                std::uniform_int_distribution<size_t> pick(0, macs.size() - 1);
+                // Заранее выбираем кадры, чтобы не мерить генератор
+                std::vector<std::pair<const u_char*, const u_char*>> frames(framesPerThread);
+                for (auto& f : frames) {
+                    size_t src = pick(rng);
+                    src -= src % threads;
+                    src = std::min(src + t, macs.size() - 1);
+                    f = {macs[src].data(), macs[pick(rng)].data()};
+                }
+
+                ready++;
+                while (!go) {
+                    std::this_thread::yield();
+                }
+                auto start = std::chrono::steady_clock::now();
+                long sink = 0;
+                for (const auto& f : frames) {
+                    table.updateEntry(f.first, t);
+                    sink += table.getPortForMac(f.second);
+                }
+                seconds[t] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (sink == -1) std::cout << "";
+            });
+        }
+
+        while (ready < threads) {
+            std::this_thread::yield();
+        }
+        go = true;
+        for (auto& w : workers) {
+            w.join();
+        }
+        return threads * framesPerThread / *std::max_element(seconds.begin(), seconds.end());
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t macCount = argc > 1 ? std::stoul(argv[1]) : 10000;
+    size_t lookupCount = argc > 2 ? std::stoul(argv[2]) : 10000000;
+    int maxThreads = argc > 3 ? std::stoi(argv[3]) : int(std::max(4u, std::thread::hardware_concurrency()));
+
+    auto known = makeMacs(macCount, 1);
+    auto unknown = makeMacs(macCount, 2);
+
+    CommutationTable table(300, std::max(macCount, CommutationTable::kDefaultCapacity));
+    LegacyMacTable legacy;
+    for (size_t i = 0; i < known.size(); ++i) {
+        table.updateEntry(known[i].data(), known[i][5] & 3);
+        legacy.updateEntry(known[i].data(), known[i][5] & 3);
+    }
+
+    // 90% известных адресов, 10% неизвестных (рассылка на все порты)
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<size_t> pick(0, macCount - 1);
+    std::vector<const u_char*> probes(lookupCount);
+    for (auto& p : probes) {
+        p = (rng() % 10 == 0) ? unknown[pick(rng)].data() : known[pick(rng)].data();
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "MAC addresses: " << macCount << ", lookups: " << lookupCount << std::endl;
+
+    double newLookups = measureLookups(table, probes);
+    double oldLookups = measureLookups(legacy, probes);
+    double newLearns = measureLearns(table, probes);
+    double oldLearns = measureLearns(legacy, probes);
+
+    std::cout << std::left << std::setw(28) << "Table" << std::setw(20) << "lookups/s" << "learns/s" << std::endl
+              << std::setw(28) << "unordered_map<string>" << std::setw(20) << oldLookups << oldLearns << std::endl
+              << std::setw(28) << "open addressing <uint64>" << std::setw(20) << newLookups << newLearns << std::endl
+              << "Speedup: x" << std::setprecision(2) << newLookups / oldLookups << " (lookup), x"
+              << newLearns / oldLearns << " (learn)" << std::endl;
+
+    std::cout << "\nForwarding scaling (learn src + lookup dst per frame)" << std::endl
+              << std::left << std::setw(10) << "Threads" << std::setw(28) << "unordered_map<string> fps"
+              << "open addressing fps" << std::endl;
+    size_t framesPerThread = std::max<size_t>(lookupCount / 10, 1);
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double oldRate = measureForwarding(legacy, known, threads, framesPerThread);
+        double newRate = measureForwarding(table, known, threads, framesPerThread);
+        std::cout << std::setprecision(1) << std::setw(10) << threads
+                  << std::setw(28) << oldRate << newRate << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "RuleTable.h"
+#include <random>
+
+/**
+ * @brief Бенчмарк классификатора правил
+ *
+ * Строит таблицу из заданного числа правил нескольких видов (точные пары адресов
+ * для ICMP, префиксы /24 с портом UDP, префиксы /16 с портом TCP, отдельные
+ * источники) и сравнивает скомпилированный классификатор с последовательным
+ * перебором правил. Результаты обоих сверяются; номер правила хранится
+ * в mirrorPort действия.
+ * Запуск: rule_table_bench [число правил] [число поисков]
+ * Код возврата 1, если классификатор и перебор разошлись.
+ */
+
+namespace {
+
+    /**
+     * @brief Проверка правила перебором (эталон)
+     */
+    bool matches(const RuleTable::Match& m, const FlowKey& key) {
+        auto prefixEq = [](uint32_t a, uint32_t b, unsigned prefix) {
+            return prefix == 0 || ((a ^ b) >> (32 - prefix)) == 0;
+        };
+        bool l4 = m.icmpType < 0 && m.srcPort < 0 && m.dstPort < 0;
+        return prefixEq(m.src, key.src, m.srcPrefix) && prefixEq(m.dst, key.dst, m.dstPrefix) &&
+               (m.proto < 0 || m.proto == key.proto) &&
+               (l4 || key.hasL4) &&
+               (m.icmpType < 0 || m.icmpType == key.icmpType) &&
+               (m.srcPort < 0 || m.srcPort == key.srcPort) &&
+               (m.dstPort < 0 || m.dstPort == key.dstPort);
+    }
+
+    int linearClassify(const std::vector<RuleTable::Match>& rules, const FlowKey& key) {
+        for (size_t i = 0; i < rules.size(); ++i) {
+            if (matches(rules[i], key)) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Генерирует правила четырёх видов
+     */
+    std::vector<RuleTable::Match> makeRules(size_t count, std::mt19937& rng) {
+        std::vector<RuleTable::Match> rules(count);
+        for (size_t i = 0; i < count; ++i) {
+            RuleTable::Match& m = rules[i];
+            switch (i % 4) {
+                case 0: // ICMP между двумя узлами
+                    m.src = 0x0A000000 | (rng() & 0xFFFFFF);
+                    m.srcPrefix = 32;
+                    m.dst = 0xC0A80000 | (rng() & 0xFFFF);
+                    m.dstPrefix = 32;
+                    m.proto = IPPROTO_ICMP;
+                    m.icmpType = ICMP_ECHOREPLY;
+                    break;
+                case 1: // Сеть источника и порт UDP
+                    m.src = (0x0A000000 | (rng() & 0xFFFFFF)) & 0xFFFFFF00;
+                    m.srcPrefix = 24;
+                    m.proto = IPPROTO_UDP;
+                    m.dstPort = int(rng() % 65536);
+                    break;
+                case 2: // Сеть назначения и порт TCP
+                    m.dst = 0xAC000000 | (uint32_t(rng() % 256) << 16);
+                    m.dstPrefix = 16;
+                    m.proto = IPPROTO_TCP;
+                    m.dstPort = int(rng() % 65536);
+                    break;
+                default: // Отдельный источник
+                    m.src = 0x0A000000 | (rng() & 0xFFFFFF);
+                    m.srcPrefix = 32;
+                    break;
+            }
+        }
+        return rules;
+    }
+
+    /**
+     * @brief Генерирует ключи: половина попадает в случайное правило, половина случайна
+     */
+    std::vector<FlowKey> makeKeys(const std::vector<RuleTable::Match>& rules, size_t count, std::mt19937& rng) {
+        std::vector<FlowKey> keys(count);
+        for (auto& key : keys) {
+            key.src = 0x0A000000 | (rng() & 0xFFFFFF);
+            key.dst = 0xC0A80000 | (rng() & 0xFFFF);
+            static const uint8_t protos[] = {IPPROTO_ICMP, IPPROTO_TCP, IPPROTO_UDP};
+            key.proto = protos[rng() % 3];
+            key.hasL4 = true;
+            if (key.proto == IPPROTO_ICMP) {
+                key.icmpType = uint8_t(rng() % 2 ? ICMP_ECHOREPLY : ICMP_ECHO);
+            } else {
+                key.srcPort = uint16_t(rng());
+                key.dstPort = uint16_t(rng());
+            }
+
+            if (rng() % 2) {
+                const RuleTable::Match& m = rules[rng() % rules.size()];
+                auto apply = [](uint32_t value, uint32_t prefix, unsigned length) {
+                    uint32_t mask = length == 0 ? 0 : ~uint32_t(0) << (32 - length);
+                    return (prefix & mask) | (value & ~mask);
+                };
+                key.src = apply(key.src, m.src, m.srcPrefix);
+                key.dst = apply(key.dst, m.dst, m.dstPrefix);
+                if (m.proto >= 0) {
+                    key.proto = uint8_t(m.proto);
+                    key.icmpType = 0;
+                    key.srcPort = key.dstPort = 0;
+                }
+                if (m.icmpType >= 0) key.icmpType = uint8_t(m.icmpType);
+                if (m.dstPort >= 0) {
+                    key.srcPort = uint16_t(rng());
+                    key.dstPort = uint16_t(m.dstPort);
+                }
+            }
+        }
+        return keys;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t ruleCount = argc > 1 ? std::stoul(argv[1]) : 10000;
+    size_t lookups = argc > 2 ? std::stoul(argv[2]) : 5000000;
+
+    std::mt19937 rng(7);
+    std::vector<RuleTable::Match> matches = makeRules(ruleCount, rng);
+    std::vector<FlowKey> keys = makeKeys(matches, lookups, rng);
+
+    auto start = std::chrono::steady_clock::now();
+    RuleTable table;
+    for (size_t i = 0; i < matches.size(); ++i) {
+        RuleAction action;
+        action.mirrorPort = int(i);
+        table.addRule(matches[i], action);
+    }
+    table.compile();
+    double compileTime = secondsSince(start);
+
+    std::cout << "Rules: " << table.size() << ", groups: " << table.tupleCount()
+              << ", shadowed: " << table.shadowedCount()
+              << ", compile: " << std::fixed << std::setprecision(1) << compileTime * 1000 << " ms" << std::endl;
+
+    // Классификатор
+    size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (const FlowKey& key : keys) {
+        hits += table.classify(key) != nullptr;
+    }
+    double compiled = secondsSince(start);
+
+    // Перебор медленный — сверяем и измеряем на части ключей
+    size_t linearLookups = std::min<size_t>(lookups, 20000);
+    std::vector<int> expected(linearLookups);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < linearLookups; ++i) {
+        expected[i] = linearClassify(matches, keys[i]);
+    }
+    double linear = secondsSince(start);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < linearLookups; ++i) {
+        const RuleAction* action = table.classify(keys[i]);
+        int actual = action ? action->mirrorPort : -1;
+        if (expected[i] != actual && mismatches++ < 5) {
+            std::cerr << "Mismatch at key " << i << ": linear " << expected[i]
+                      << ", classifier " << actual << std::endl;
+        }
+    }
+
+    std::cout << std::setprecision(1)
+              << "Classifier: " << double(lookups) / compiled / 1e6 << " M lookups/s, "
+              << compiled / double(lookups) * 1e9 << " ns/lookup, hit rate "
+              << 100.0 * double(hits) / double(lookups) << "%" << std::endl
+              << "Linear:     " << linear / double(linearLookups) * 1e9 << " ns/lookup, classifier is "
+              << (linear / double(linearLookups)) / (compiled / double(lookups)) << "x faster" << std::endl
+              << "Verify: " << (mismatches ? "FAILED" : "ok") << " (" << linearLookups << " keys)" << std::endl;
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,327 @@
+#include "Forwarder.h"
+#include "MemoryPort.h"
+#include "LatencyHistogram.h"
+#include "NetworkUtils/NetworkUtils.h"
+#include <unordered_set>
+
+/**
+ * @brief Бенчмарк коммутатора на записанном трафике (файлы pcap)
+ *
+ * Кадры из одного или нескольких файлов pcap загружаются в память и в порядке
+ * меток времени (кадры разных файлов чередуются) прогоняются через тот же forwardFrame/processPacket и CommutationTable,
+ * что и в Commutation_table. Порты — виртуальные (MemoryPort): пачка кадров
+ * кладётся в порты приёма, обрабатывается, затем Egress::flush() отправляет
+ * накопленное. Работа однопоточная, поэтому результат повторяем.
+ *
+ * Порт приёма кадра: при нескольких файлах — номер файла (по модулю числа портов),
+ * при одном файле — хэш MAC-адреса источника, то есть хост всегда за одним портом.
+ *
+ * Выводятся кадры/с, Гбит/с (по длине кадров без преамбулы и межкадрового
+ * интервала), перцентили времени обработки кадра, доля попаданий в таблицу
+ * для индивидуальных адресов и доля кадров, разосланных во все порты.
+ *
+ * Запуск: switch_bench [-p портов] [-r кадров/с] [-l повторов] [-w] [-R файл_правил] [-c записей] file.pcap...
+ *   -r 0 (по умолчанию) — максимальная скорость, иначе пачки выдаются по расписанию;
+ *   -w — один непрерывный прогон для обучения таблицы перед замером;
+ *   в файле правил порты называются port0, port1, ...;
+ *   -c — записей кэша решений на порт (по умолчанию 1024, 0 — без кэша)
+ */
+
+namespace {
+
+    constexpr size_t kBurst = 32;
+
+    /**
+     * @struct RecordedFrame
+     * @brief Кадр из файла: положение в общем буфере и порт приёма
+     */
+    struct RecordedFrame {
+        uint64_t timestampUs;
+        size_t offset;
+        uint32_t caplen;
+        uint32_t len;
+        uint32_t port;
+    };
+
+    /**
+     * @struct Trace
+     * @brief Все загруженные кадры
+     */
+    struct Trace {
+        std::vector<u_char> data;
+        std::vector<RecordedFrame> frames;
+        uint32_t maxCaplen = 0;
+        uint64_t wireBytes = 0;
+        std::unordered_set<uint64_t> sources; ///< MAC-адреса источников (для ёмкости таблицы)
+    };
+
+    /**
+     * @struct TimedContext
+     * @brief Контекст порта и гистограмма времени обработки кадра
+     */
+    struct TimedContext {
+        CaptureContext ctx;
+        LatencyHistogram* histogram;
+    };
+
+    void timedForward(void* user, u_char* data, uint32_t caplen, uint32_t len) {
+        auto* timed = static_cast<TimedContext*>(user);
+        auto start = std::chrono::steady_clock::now();
+        forwardFrame(&timed->ctx, data, caplen, len);
+        timed->histogram->record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count()));
+    }
+
+    /**
+     * @brief Загружает кадры Ethernet из файла pcap
+     * @throws std::runtime_error Если файл не открывается или не содержит кадров Ethernet
+     */
+    void loadTrace(const std::string& filename, size_t fileIndex, size_t portCount, bool byFile, Trace& trace) {
+        char errbuf[PCAP_ERRBUF_SIZE];
+        pcap_t* handle = pcap_open_offline(filename.c_str(), errbuf);
+        if (!handle) {
+            throw std::runtime_error("Couldn't open " + filename + ": " + errbuf);
+        }
+        if (pcap_datalink(handle) != DLT_EN10MB) {
+            pcap_close(handle);
+            throw std::runtime_error(filename + ": not an Ethernet capture");
+        }
+
+        struct pcap_pkthdr* header;
+        const u_char* packet;
+        int status;
+        while ((status = pcap_next_ex(handle, &header, &packet)) == 1) {
+            uint32_t port;
+            if (byFile) {
+                port = uint32_t(fileIndex % portCount);
+            } else if (header->caplen >= 12) {
+                port = uint32_t(std::hash<uint64_t>{}(utils::macToU64(packet + 6)) % portCount);
+            } else {
+                port = 0;
+            }
+            if (header->caplen >= 12) {
+                trace.sources.insert(utils::macToU64(packet + 6));
+            }
+            uint64_t timestampUs = uint64_t(header->ts.tv_sec) * 1000000 + uint64_t(header->ts.tv_usec);
+            trace.frames.push_back({timestampUs, trace.data.size(), header->caplen, header->len, port});
+            trace.data.insert(trace.data.end(), packet, packet + header->caplen);
+            trace.maxCaplen = std::max(trace.maxCaplen, header->caplen);
+            trace.wireBytes += header->len;
+        }
+        if (status == -1) {
+            std::string message = filename + ": " + pcap_geterr(handle);
+            pcap_close(handle);
+            throw std::runtime_error(message);
+        }
+        pcap_close(handle);
+    }
+
+    /**
+     * @brief Прогоняет все кадры один раз
+     * @param rate Кадров в секунду, 0 — без ограничения
+     * @param startTime Начало расписания (для rate > 0)
+     * @param scheduled Номер первого кадра прогона в расписании
+     */
+    void replay(const Trace& trace, std::vector<MemoryPort*>& ports, std::vector<TimedContext>& contexts,
+                Egress& egress, double rate, std::chrono::steady_clock::time_point startTime, uint64_t scheduled) {
+        const size_t portCount = ports.size();
+        for (size_t base = 0; base < trace.frames.size(); base += kBurst) {
+            size_t end = std::min(base + kBurst, trace.frames.size());
+            if (rate > 0) {
+                auto due = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(double(scheduled + base) / rate));
+                while (std::chrono::steady_clock::now() < due) {
+                }
+            }
+            for (size_t i = base; i < end; ++i) {
+                // Кадр, записанный не целиком, передаётся со своей длиной в сети: его отбросит processPacket
+                const RecordedFrame& frame = trace.frames[i];
+                ports[frame.port]->inject(trace.data.data() + frame.offset, frame.caplen, frame.len);
+            }
+            for (size_t port = 0; port < portCount; ++port) {
+                ports[port]->receiveBurst(kBurst, 0, timedForward, &contexts[port]);
+            }
+            egress.flush();
+        }
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t portCount = 0;
+    double rate = 0;
+    size_t loops = 1;
+    bool warmup = false;
+    std::string rulesFile;
+    size_t flowCacheSize = 1024;
+
+    int option;
+    while ((option = getopt(argc, argv, "p:r:l:wR:c:")) != -1) {
+        switch (option) {
+            case 'p': portCount = std::stoul(optarg); break;
+            case 'r': rate = std::stod(optarg); break;
+            case 'l': loops = std::max<size_t>(1, std::stoul(optarg)); break;
+            case 'w': warmup = true; break;
+            case 'R': rulesFile = optarg; break;
+            case 'c': flowCacheSize = std::stoul(optarg); break;
+            default:
+                std::cerr << "Usage: switch_bench [-p ports] [-r pps] [-l loops] [-w] [-R rules] [-c cache] file.pcap..." << std::endl;
+                return 1;
+        }
+    }
+    std::vector<std::string> files(argv + optind, argv + argc);
+    if (files.empty()) {
+        std::cerr << "Usage: switch_bench [-p ports] [-r pps] [-l loops] [-w] [-R rules] [-c cache] file.pcap..." << std::endl;
+        return 1;
+    }
+    bool byFile = files.size() > 1;
+    if (portCount == 0) {
+        portCount = byFile ? std::max<size_t>(files.size(), 2) : 4;
+    }
+    if (portCount < 2) {
+        std::cerr << "At least 2 ports are required" << std::endl;
+        return 1;
+    }
+
+    Trace trace;
+    try {
+        for (size_t i = 0; i < files.size(); ++i) {
+            loadTrace(files[i], i, portCount, byFile, trace);
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (trace.frames.empty()) {
+        std::cerr << "No frames loaded" << std::endl;
+        return 1;
+    }
+    if (byFile) {
+        std::stable_sort(trace.frames.begin(), trace.frames.end(),
+                         [](const RecordedFrame& a, const RecordedFrame& b) { return a.timestampUs < b.timestampUs; });
+    }
+
+    std::vector<SwitchPort> ports;
+    std::vector<MemoryPort*> memoryPorts;
+    std::vector<std::string> portNames;
+    for (size_t i = 0; i < portCount; ++i) {
+        SwitchPort port;
+        port.name = "port" + std::to_string(i);
+        portNames.push_back(port.name);
+        auto io = std::make_unique<MemoryPort>(port.name, 2 * kBurst, std::max<uint32_t>(trace.maxCaplen, 64));
+        memoryPorts.push_back(io.get());
+        port.io.push_back(std::move(io));
+        ports.push_back(std::move(port));
+    }
+
+    RuleTable rules;
+    if (!rulesFile.empty()) {
+        try {
+            rules.loadFromFile(rulesFile, portNames);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    rules.compile();
+
+    CommutationTable table(3600, std::max(CommutationTable::kDefaultCapacity, 2 * trace.sources.size()));
+    EgressConfig egressConfig;
+    egressConfig.queueDepth = 8 * kBurst;
+    egressConfig.frameSize = std::max<uint32_t>(trace.maxCaplen, 64);
+    Egress egress(ports, egressConfig);
+
+    auto histogram = std::make_unique<LatencyHistogram>();
+    std::vector<std::unique_ptr<FlowCache>> caches;
+    std::vector<TimedContext> contexts;
+    for (size_t i = 0; i < portCount; ++i) {
+        if (flowCacheSize) {
+            caches.push_back(std::make_unique<FlowCache>(flowCacheSize));
+        }
+        contexts.push_back({{int(i), true, &table, &egress, &rules, ports[i].ingress.get(),
+                             flowCacheSize ? caches.back().get() : nullptr, nullptr}, histogram.get()});
+    }
+
+    if (warmup) {
+        replay(trace, memoryPorts, contexts, egress, 0, std::chrono::steady_clock::now(), 0);
+        // Время обработки при обучении в замер не входит
+        histogram = std::make_unique<LatencyHistogram>();
+        for (auto& context : contexts) {
+            context.histogram = histogram.get();
+        }
+    }
+
+    // Замер считается по разности счётчиков до и после
+    auto collect = [&](uint64_t& rx, uint64_t& tx, uint64_t& truncated, uint64_t& dropped,
+                       uint64_t& flooded, uint64_t& unknown, uint64_t& hits, uint64_t& misses) {
+        rx = tx = truncated = dropped = flooded = unknown = hits = misses = 0;
+        for (const auto& cache : caches) {
+            hits += cache->hits();
+            misses += cache->misses();
+        }
+        for (const auto& port : ports) {
+            IoPortStats stats = port.io[0]->stats();
+            rx += stats.rxFrames;
+            tx += stats.txFrames;
+            truncated += port.ingress->truncated.load(std::memory_order_relaxed);
+            dropped += port.ingress->dropped.load(std::memory_order_relaxed);
+            flooded += port.ingress->flooded.load(std::memory_order_relaxed);
+            unknown += port.ingress->unknownUnicast.load(std::memory_order_relaxed);
+        }
+    };
+    uint64_t rx0, tx0, truncated0, dropped0, flooded0, unknown0, hits0, misses0;
+    collect(rx0, tx0, truncated0, dropped0, flooded0, unknown0, hits0, misses0);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t loop = 0; loop < loops; ++loop) {
+        replay(trace, memoryPorts, contexts, egress, rate, start, uint64_t(loop) * trace.frames.size());
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t rx, tx, truncated, dropped, flooded, unknown, hits, misses;
+    collect(rx, tx, truncated, dropped, flooded, unknown, hits, misses);
+    rx -= rx0;
+    tx -= tx0;
+    truncated -= truncated0;
+    dropped -= dropped0;
+    flooded -= flooded0;
+    unknown -= unknown0;
+    hits -= hits0;
+    misses -= misses0;
+
+    LatencyHistogram::Snapshot latency;
+    histogram->addTo(latency);
+
+    // Кадры, дошедшие до решения о пересылке, и среди них — с индивидуальным адресом назначения
+    uint64_t decided = rx - truncated - dropped;
+    uint64_t unicast = decided - (flooded - unknown);
+    double bytes = double(trace.wireBytes) * double(loops);
+
+    std::cout << "Frames: " << trace.frames.size() << " x " << loops << " from " << files.size() << " file(s), "
+              << portCount << " ports (by " << (byFile ? "file" : "source MAC") << "), rules: " << rules.size()
+              << (warmup ? ", warmed up" : "") << std::endl
+              << std::fixed << std::setprecision(0)
+              << "Rate:      " << double(rx) / elapsed << " frames/s" << std::setprecision(3)
+              << ", " << bytes * 8 / elapsed / 1e9 << " Gbit/s"
+              << (rate > 0 ? " (paced)" : " (max speed)") << std::endl
+              << "Latency:   p50 " << latency.percentile(50) << " ns, p90 " << latency.percentile(90)
+              << " ns, p99 " << latency.percentile(99) << " ns, p99.9 " << latency.percentile(99.9)
+              << " ns, max " << latency.max << " ns" << std::endl
+              << std::setprecision(2)
+              << "MAC table: " << table.size() << " entries, unicast hit rate "
+              << (unicast ? 100.0 * double(unicast - unknown) / double(unicast) : 0.0) << "%" << std::endl
+              << "Flooded:   " << (decided ? 100.0 * double(flooded) / double(decided) : 0.0) << "% of "
+              << decided << " forwarded frames (" << unknown << " unknown unicast)" << std::endl
+              << "Flow cache: ";
+    if (flowCacheSize) {
+        std::cout << flowCacheSize << " entries per port, hit rate "
+                  << (hits + misses ? 100.0 * double(hits) / double(hits + misses) : 0.0) << "%" << std::endl;
+    } else {
+        std::cout << "disabled" << std::endl;
+    }
+    std::cout
+              << "Dropped:   " << dropped << ", truncated: " << truncated << ", sent: " << tx
+              << " (" << double(tx) / double(std::max<uint64_t>(rx, 1)) << " per frame)"
+              << std::defaultfloat << std::endl;
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include "Forwarder.h"
+#include "MemoryPort.h"
+#include <array>
+#include <random>
+
+/**
+ * @brief Детерминированный бенчмарк коммутатора на виртуальных портах
+ *
+ * Коммутатор из N портов MemoryPort собирается в одном процессе и работает
+ * в одном потоке: в каждом раунде в каждый порт кладётся пачка кадров,
+ * кадры портов обрабатываются тем же forwardFrame/processPacket, что и
+ * в Commutation_table, затем Egress::flush() отправляет накопленное в порты.
+ * За каждым портом — hosts_per_port хостов; кадры идут между хостами разных
+ * портов (последовательность задаётся фиксированным зерном), каждый
+ * broadcast_every-й кадр — широковещательный. Перед замером каждый хост
+ * отправляет по кадру, поэтому все индивидуальные кадры уходят ровно в один порт.
+ *
+ * Сетевые карты и права root не нужны. Выводится стоимость обработки кадра
+ * без копирования в порт (его делала бы сетевая карта) и с ним, а также
+ * сверка числа отправленных кадров с ожидаемым. У каждого порта свой кэш решений
+ * (FlowCache) на flow_cache_size записей; 0 — замер без кэша.
+ *
+ * Режим (mode) включает одну из необязательных функций коммутатора:
+ *   plain — без них;
+ *   vlan  — все порты во VLAN 10: чётные — access, нечётные — trunk, кадры
+ *           которых приходят с тегом; кадры между ними получают и теряют тег;
+ *   lag   — соседние порты (0 и 1, 2 и 3, ...) объединены в группы агрегирования,
+ *           канал группы выбирается по хэшу потока, кадры идут между группами;
+ *   dup   — фильтр копий: каждый отправленный кадр возвращается эхом в порт,
+ *           в который он ушёл; выводится доля копий, отброшенных фильтром.
+ *           Кадры, вызванные пропущенными копиями, отправляются без эха и
+ *           в сверке не учитываются. Время кадра включает обработку его эха.
+ * Запуск: vswitch_bench [портов] [хостов на порт] [миллионов кадров] [broadcast_every] [flow_cache_size] [mode]
+ */
+
+namespace {
+
+    constexpr size_t kFrameSize = 64;
+    constexpr size_t kBurst = 32;
+    /// VLAN всех портов в режиме vlan
+    constexpr uint16_t kBenchVlan = 10;
+    /// Окно фильтра копий в режиме dup: с запасом больше длительности раунда при любом числе портов
+    constexpr uint32_t kDuplicateWindowUs = 10000;
+    /// Ячеек фильтра копий в режиме dup: запись редко вытесняется до возврата её эха
+    constexpr size_t kDuplicateSlots = 1 << 20;
+    /// Смещение номера раунда в кадре режима dup (данные UDP): кадры не повторяются в пределах окна
+    constexpr size_t kRoundOffset = 42;
+
+    /**
+     * @enum Mode
+     * @brief Необязательная функция коммутатора, включённая в замере
+     */
+    enum class Mode {
+        Plain,
+        Vlan,
+        Lag,
+        Duplicates,
+    };
+
+    /**
+     * @struct Frame
+     * @brief Заранее построенный кадр и порт, в который он поступает
+     */
+    struct Frame {
+        std::array<u_char, kFrameSize + 4> data;  ///< Место и для тега VLAN
+        uint32_t length;
+        size_t port;
+        bool broadcast;
+    };
+
+    /**
+     * @struct EchoQueue
+     * @brief Кадры, отправленные в порт за раунд: в режиме dup они возвращаются в тот же порт
+     */
+    struct EchoQueue {
+        std::vector<u_char> data;
+        std::vector<uint32_t> lengths;
+        bool recording = true;  ///< false — кадры, вызванные пропущенными копиями, эха не дают
+    };
+
+    void recordEcho(void* user, u_char* data, uint32_t caplen, uint32_t) {
+        auto* queue = static_cast<EchoQueue*>(user);
+        if (!queue->recording) {
+            return;
+        }
+        queue->data.insert(queue->data.end(), data, data + caplen);
+        queue->lengths.push_back(caplen);
+    }
+
+    void hostMac(size_t port, size_t host, u_char* mac) {
+        const u_char base[6] = {0x02, 0, 0, 0, 0, 0};
+        memcpy(mac, base, 6);
+        mac[2] = u_char(port);
+        mac[3] = u_char(host >> 16);
+        mac[4] = u_char(host >> 8);
+        mac[5] = u_char(host);
+    }
+
+    /**
+     * @param id Поле идентификации IPv4: одинаковые широковещательные кадры в пределах
+     *           окна фильтра копий были бы для него петлёй
+     */
+    Frame makeFrame(size_t srcPort, size_t srcHost, size_t dstPort, size_t dstHost, bool broadcast,
+                    uint16_t id = 0) {
+        Frame frame{};
+        frame.length = kFrameSize;
+        frame.port = srcPort;
+        frame.broadcast = broadcast;
+        auto* eth = reinterpret_cast<struct ether_header*>(frame.data.data());
+        hostMac(srcPort, srcHost, eth->ether_shost);
+        if (broadcast) {
+            memset(eth->ether_dhost, 0xFF, 6);
+        } else {
+            hostMac(dstPort, dstHost, eth->ether_dhost);
+        }
+        eth->ether_type = htons(ETHERTYPE_IP);
+
+        auto* ip = reinterpret_cast<struct ip*>(frame.data.data() + sizeof(struct ether_header));
+        ip->ip_v = 4;
+        ip->ip_hl = 5;
+        ip->ip_len = htons(kFrameSize - sizeof(struct ether_header));
+        ip->ip_id = htons(id);
+        ip->ip_ttl = 64;
+        ip->ip_p = IPPROTO_UDP;
+        ip->ip_src.s_addr = htonl(0x0A000000 | uint32_t(srcPort << 16) | uint32_t(srcHost));
+        ip->ip_dst.s_addr = htonl(0x0A000000 | uint32_t(dstPort << 16) | uint32_t(dstHost));
+        return frame;
+    }
+
+    /**
+     * @brief Вставляет в кадр тег 802.1Q
+     */
+    void addVlanTag(Frame& frame, uint16_t vlan) {
+        memmove(frame.data.data() + 16, frame.data.data() + 12, frame.length - 12);
+        uint16_t tag[2] = {htons(ETHERTYPE_VLAN), htons(vlan)};
+        memcpy(frame.data.data() + 12, tag, sizeof(tag));
+        frame.length += 4;
+    }
+
+    /**
+     * @brief Кадр, который хост отправляет в порт в заданном режиме (в режиме vlan порт trunk ставит тег)
+     */
+    Frame portFrame(Mode mode, size_t srcPort, size_t srcHost, size_t dstPort, size_t dstHost, bool broadcast,
+                    uint16_t id = 0) {
+        Frame frame = makeFrame(srcPort, srcHost, dstPort, dstHost, broadcast, id);
+        if (mode == Mode::Vlan && srcPort % 2 == 1) {
+            addVlanTag(frame, kBenchVlan);
+        }
+        return frame;
+    }
+
+    /**
+     * @brief Строит по kBurst кадров на порт на каждый раунд
+     * @param groupSize Портов в группе агрегирования: кадры идут только между группами
+     */
+    std::vector<Frame> makeTraffic(size_t ports, size_t hosts, size_t rounds, size_t broadcastEvery, Mode mode,
+                                   size_t groupSize) {
+        const size_t groups = ports / groupSize;
+        std::mt19937 rng(7);
+        std::vector<Frame> frames;
+        frames.reserve(rounds * ports * kBurst);
+        size_t sequence = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t port = 0; port < ports; ++port) {
+                for (size_t i = 0; i < kBurst; ++i) {
+                    size_t dstPort = (port / groupSize + 1 + rng() % (groups - 1)) % groups * groupSize;
+                    if (groupSize > 1) {
+                        dstPort += rng() % groupSize;
+                    }
+                    ++sequence;
+                    bool broadcast = broadcastEvery && sequence % broadcastEvery == 0;
+                    frames.push_back(portFrame(mode, port, rng() % hosts, dstPort, rng() % hosts, broadcast,
+                                               uint16_t(sequence)));
+                }
+            }
+        }
+        return frames;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t portCount = argc > 1 ? std::stoul(argv[1]) : 4;
+    size_t hosts = argc > 2 ? std::stoul(argv[2]) : 256;
+    size_t totalFrames = size_t((argc > 3 ? std::stod(argv[3]) : 10.0) * 1e6);
+    size_t broadcastEvery = argc > 4 ? std::stoul(argv[4]) : 64;
+    size_t flowCacheSize = argc > 5 ? std::stoul(argv[5]) : 1024;
+    std::string modeName = argc > 6 ? argv[6] : "plain";
+    Mode mode = Mode::Plain;
+    if (modeName == "vlan") {
+        mode = Mode::Vlan;
+    } else if (modeName == "lag") {
+        mode = Mode::Lag;
+    } else if (modeName == "dup") {
+        mode = Mode::Duplicates;
+    } else if (modeName != "plain") {
+        portCount = 0;
+    }
+    const size_t groupSize = mode == Mode::Lag ? 2 : 1;
+    if (portCount < 2 || portCount > 255 || hosts == 0 || hosts > 65535 ||
+        (mode == Mode::Lag && (portCount < 4 || portCount % 2 != 0))) {
+        std::cerr << "Usage: vswitch_bench [ports 2..255] [hosts_per_port 1..65535] [Mframes] [broadcast_every] "
+                     "[flow_cache_size] [plain|vlan|lag|dup]" << std::endl
+                  << "  lag needs an even number of ports, at least 4" << std::endl;
+        return 1;
+    }
+
+    // Одного набора раундов хватает на весь замер: он повторяется по кругу
+    size_t patternRounds = std::max<size_t>(1, std::min<size_t>(4096, 262144 / (portCount * kBurst)));
+    std::vector<Frame> traffic = makeTraffic(portCount, hosts, patternRounds, broadcastEvery, mode, groupSize);
+    size_t roundFrames = portCount * kBurst;
+    size_t rounds = std::max<size_t>(1, totalFrames / roundFrames);
+
+    std::vector<SwitchPort> ports;
+    std::vector<MemoryPort*> memoryPorts;
+    for (size_t i = 0; i < portCount; ++i) {
+        SwitchPort port;
+        port.name = "vport" + std::to_string(i);
+        auto io = std::make_unique<MemoryPort>(port.name, 4 * kBurst, kFrameSize + 4);
+        memoryPorts.push_back(io.get());
+        port.io.push_back(std::move(io));
+        ports.push_back(std::move(port));
+    }
+
+    CommutationTable table(3600, std::max(CommutationTable::kDefaultCapacity, portCount * hosts));
+    RuleTable rules;
+    rules.compile();
+    EgressConfig egressConfig;
+    egressConfig.queueDepth = 4 * roundFrames;
+    egressConfig.frameSize = kFrameSize + 4;
+    Egress egress(ports, egressConfig);
+
+    ForwardingFeatures features;
+    std::unique_ptr<VlanTable> vlans;
+    std::unique_ptr<LagTable> lags;
+    std::unique_ptr<DuplicateFilter> duplicates;
+    std::vector<EchoQueue> echoQueues(portCount);
+    if (mode == Mode::Vlan) {
+        vlans = std::make_unique<VlanTable>(portCount);
+        for (size_t i = 0; i < portCount; ++i) {
+            if (i % 2 == 0) {
+                vlans->setAccess(i, kBenchVlan);
+            } else {
+                vlans->setTrunk(i, 0, {kBenchVlan});
+            }
+        }
+        features.vlans = vlans.get();
+    } else if (mode == Mode::Lag) {
+        lags = std::make_unique<LagTable>(portCount, LagHashPolicy::Layer23);
+        for (size_t i = 0; i < portCount; i += 2) {
+            lags->addGroup("po" + std::to_string(i / 2), {int(i), int(i + 1)});
+        }
+        features.lags = lags.get();
+    } else if (mode == Mode::Duplicates) {
+        duplicates = std::make_unique<DuplicateFilter>(kDuplicateSlots, kDuplicateWindowUs);
+        for (size_t i = 0; i < portCount; ++i) {
+            memoryPorts[i]->setTxTap(recordEcho, &echoQueues[i]);
+        }
+        features.duplicates = duplicates.get();
+    }
+
+    std::vector<std::unique_ptr<FlowCache>> caches;
+    std::vector<CaptureContext> contexts;
+    for (size_t i = 0; i < portCount; ++i) {
+        if (flowCacheSize) {
+            caches.push_back(std::make_unique<FlowCache>(flowCacheSize));
+        }
+        contexts.push_back({int(i), true, &table, &egress, &rules, ports[i].ingress.get(),
+                            flowCacheSize ? caches.back().get() : nullptr, &features});
+    }
+
+    auto filtered = [&]() {
+        uint64_t total = 0;
+        for (const auto& port : ports) {
+            total += port.ingress->echoed.load(std::memory_order_relaxed) +
+                     port.ingress->looped.load(std::memory_order_relaxed);
+        }
+        return total;
+    };
+    auto sentFrames = [&]() {
+        uint64_t total = 0;
+        for (const auto& port : ports) {
+            total += port.io[0]->stats().txFrames;
+        }
+        return total;
+    };
+    // Эхо отправленного за раунд возвращается в порт отправки перед следующим раундом;
+    // пропущенные фильтром копии сразу отправляются дальше, но уже без эха
+    uint64_t echoed = 0;
+    uint64_t leakedSent = 0;
+    auto returnEchoes = [&]() {
+        if (mode != Mode::Duplicates) {
+            return;
+        }
+        uint64_t filteredBefore = filtered();
+        size_t returned = 0;
+        for (size_t port = 0; port < portCount; ++port) {
+            EchoQueue& queue = echoQueues[port];
+            size_t offset = 0;
+            for (uint32_t length : queue.lengths) {
+                forwardFrame(&contexts[port], queue.data.data() + offset, length, length);
+                offset += length;
+            }
+            returned += queue.lengths.size();
+            queue.data.clear();
+            queue.lengths.clear();
+        }
+        echoed += returned;
+        if (filtered() - filteredBefore != returned) {
+            uint64_t sentBefore = sentFrames();
+            for (auto& queue : echoQueues) {
+                queue.recording = false;
+            }
+            egress.flush();
+            for (auto& queue : echoQueues) {
+                queue.recording = true;
+            }
+            leakedSent += sentFrames() - sentBefore;
+        }
+    };
+
+    // Обучение: каждый хост отправляет по широковещательному кадру
+    for (size_t host = 0; host < hosts; ++host) {
+        for (size_t port = 0; port < portCount; ++port) {
+            Frame frame = portFrame(mode, port, host, 0, 0, true);
+            memoryPorts[port]->inject(frame.data.data(), frame.length);
+            memoryPorts[port]->receiveBurst(kBurst, 0, forwardFrame, &contexts[port]);
+        }
+        egress.flush();
+        returnEchoes();
+    }
+    uint64_t echoedBefore = echoed;
+    uint64_t leakedBefore = leakedSent;
+    uint64_t filteredBefore = filtered();
+    uint64_t rxBefore = 0, txBefore = 0, hitsBefore = 0, missesBefore = 0;
+    for (const auto& cache : caches) {
+        hitsBefore += cache->hits();
+        missesBefore += cache->misses();
+    }
+    for (const auto& port : ports) {
+        rxBefore += port.io[0]->stats().rxFrames;
+        txBefore += port.io[0]->stats().txFrames;
+    }
+
+    uint64_t expected = 0;
+    std::chrono::nanoseconds injectTime{0};
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        const Frame* batch = &traffic[(round % patternRounds) * roundFrames];
+        auto injectStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < roundFrames; ++i) {
+            if (mode == Mode::Duplicates) {
+                Frame frame = batch[i];
+                uint32_t stamp = uint32_t(round);
+                memcpy(frame.data.data() + kRoundOffset, &stamp, sizeof(stamp));
+                memoryPorts[frame.port]->inject(frame.data.data(), frame.length);
+            } else {
+                memoryPorts[batch[i].port]->inject(batch[i].data.data(), batch[i].length);
+            }
+            expected += batch[i].broadcast ? portCount / groupSize - 1 : 1;
+        }
+        injectTime += std::chrono::steady_clock::now() - injectStart;
+        for (size_t port = 0; port < portCount; ++port) {
+            memoryPorts[port]->receiveBurst(kBurst, 0, forwardFrame, &contexts[port]);
+        }
+        egress.flush();
+        returnEchoes();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double forwarding = elapsed - std::chrono::duration<double>(injectTime).count();
+
+    uint64_t received = 0, sent = 0;
+    for (const auto& port : ports) {
+        IoPortStats stats = port.io[0]->stats();
+        received += stats.rxFrames;
+        sent += stats.txFrames;
+    }
+    received -= rxBefore;
+    sent -= txBefore;
+    uint64_t frames = uint64_t(rounds) * roundFrames;
+    uint64_t hits = 0, misses = 0;
+    for (const auto& cache : caches) {
+        hits += cache->hits();
+        misses += cache->misses();
+    }
+    hits -= hitsBefore;
+    misses -= missesBefore;
+    uint64_t echoes = echoed - echoedBefore;
+    uint64_t filteredEchoes = filtered() - filteredBefore;
+    sent -= leakedSent - leakedBefore;
+
+    std::cout << "Ports: " << portCount << ", hosts per port: " << hosts << ", MACs learned: " << table.size()
+              << ", frames: " << frames << ", broadcast every " << broadcastEvery << ", mode " << modeName
+              << std::endl
+              << std::fixed << std::setprecision(1)
+              << "Forwarding:  " << std::setw(8) << forwarding * 1e9 / double(frames) << " ns/frame  "
+              << std::setprecision(2) << std::setw(8) << double(frames) / forwarding / 1e6 << " Mpps" << std::endl
+              << std::setprecision(1)
+              << "With inject: " << std::setw(8) << elapsed * 1e9 / double(frames) << " ns/frame  "
+              << std::setprecision(2) << std::setw(8) << double(frames) / elapsed / 1e6 << " Mpps"
+              << std::defaultfloat << std::endl
+              << "Received " << received << ", sent " << sent << " (expected " << expected << ")" << std::endl;
+    if (flowCacheSize) {
+        std::cout << "Flow cache: " << flowCacheSize << " entries per port, hit rate " << std::fixed
+                  << std::setprecision(1) << (hits + misses ? 100.0 * double(hits) / double(hits + misses) : 0.0)
+                  << "%" << std::defaultfloat << std::endl;
+    } else {
+        std::cout << "Flow cache: disabled" << std::endl;
+    }
+    if (mode == Mode::Duplicates) {
+        std::cout << "Duplicate filter: " << filteredEchoes << " of " << echoes << " echoes dropped ("
+                  << std::fixed << std::setprecision(3)
+                  << (echoes ? 100.0 * double(filteredEchoes) / double(echoes) : 0.0) << "%), "
+                  << leakedSent - leakedBefore << " frames sent for missed ones" << std::defaultfloat << std::endl;
+    }
+    if (sent != expected) {
+        std::cerr << "Sent frame count does not match the expected one" << std::endl;
+        egress.printStats();
+        return 1;
+    }
+    return 0;
+}
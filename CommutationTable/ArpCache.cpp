@@ -0,0 +1,259 @@
+#include "ArpCache.h"
+
+namespace {
+
+    constexpr int kEth = int(sizeof(struct ether_header));
+    /// Ethernet + ARP для IPv4 поверх Ethernet
+    constexpr int kArpFrame = kEth + 28;
+
+    // Смещения полей от начала заголовка ARP
+    constexpr size_t kOperation = 6;
+    constexpr size_t kSenderMac = 8;
+    constexpr size_t kSenderIp = 14;
+    constexpr size_t kTargetMac = 18;
+    constexpr size_t kTargetIp = 24;
+
+    constexpr uint16_t kRequest = 1;
+    constexpr uint16_t kReply = 2;
+
+    uint32_t readU32(const u_char* p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return ntohl(value);
+    }
+
+    uint16_t readU16(const u_char* p) {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return ntohs(value);
+    }
+
+    uint64_t packMac(const u_char* mac) {
+        uint64_t value = 0;
+        for (int i = 0; i < 6; ++i) {
+            value = (value << 8) | mac[i];
+        }
+        return value;
+    }
+
+    void unpackMac(uint64_t value, u_char* mac) {
+        for (int i = 5; i >= 0; --i) {
+            mac[i] = u_char(value);
+            value >>= 8;
+        }
+    }
+
+    /**
+     * @brief Заголовок ARP кадра, если это ARP для IPv4 поверх Ethernet, иначе nullptr
+     */
+    const u_char* arpHeader(const u_char* frame, int length) {
+        const auto* eth = reinterpret_cast<const struct ether_header*>(frame);
+        if (length < kArpFrame || eth->ether_type != htons(ETHERTYPE_ARP)) {
+            return nullptr;
+        }
+        const u_char* arp = frame + kEth;
+        if (readU16(arp) != ARPHRD_ETHER || readU16(arp + 2) != ETHERTYPE_IP || arp[4] != 6 || arp[5] != 4) {
+            return nullptr;
+        }
+        return arp;
+    }
+
+} // namespace
+
+ArpCache::ArpCache(size_t capacity, uint32_t timeoutSec)
+    : capacity_(capacity),
+      timeoutSec_(timeoutSec),
+      epoch_(std::chrono::steady_clock::now()) {
+    // Заполнение не выше половины: цепочки проб остаются короткими
+    size_t slotCount = 16;
+    while (slotCount < capacity_ * 2) {
+        slotCount <<= 1;
+    }
+    slots_.reset(new Slot[slotCount]);
+    mask_ = slotCount - 1;
+}
+
+uint32_t ArpCache::nowSec() const {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - epoch_).count());
+}
+
+size_t ArpCache::homeSlot(uint64_t key) const {
+    return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+}
+
+bool ArpCache::lookup(uint64_t key, uint64_t& mac) const {
+    for (;;) {
+        uint32_t version = seq_.load(std::memory_order_acquire);
+        if (version & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        bool found = false;
+        size_t i = homeSlot(key);
+        for (size_t probes = 0; probes <= mask_; ++probes) {
+            uint64_t slotKey = slots_[i].key.load(std::memory_order_acquire);
+            if (slotKey == 0) {
+                break;
+            }
+            if (slotKey == key) {
+                mac = slots_[i].mac.load(std::memory_order_relaxed);
+                found = true;
+                break;
+            }
+            i = (i + 1) & mask_;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == version) {
+            return found;
+        }
+    }
+}
+
+/**
+ * @note Вызывается под мьютексом
+ */
+void ArpCache::insert(uint64_t key, uint64_t mac, uint32_t now) {
+    size_t i = homeSlot(key);
+    for (;;) {
+        uint64_t slotKey = slots_[i].key.load(std::memory_order_relaxed);
+        if (slotKey == key) {
+            slots_[i].mac.store(mac, std::memory_order_relaxed);
+            slots_[i].seen.store(now, std::memory_order_relaxed);
+            return;
+        }
+        if (slotKey == 0) {
+            break;
+        }
+        i = (i + 1) & mask_;
+    }
+    if (size_.load(std::memory_order_relaxed) >= capacity_) {
+        return;
+    }
+    slots_[i].mac.store(mac, std::memory_order_relaxed);
+    slots_[i].seen.store(now, std::memory_order_relaxed);
+    slots_[i].key.store(key, std::memory_order_release);
+    size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ArpCache::learn(const u_char* frame, int length, uint16_t vlan) {
+    const u_char* arp = arpHeader(frame, length);
+    if (!arp) {
+        return;
+    }
+    uint16_t operation = readU16(arp + kOperation);
+    uint32_t senderIp = readU32(arp + kSenderIp);
+    // Запрос сообщает привязку отправителя, только если он gratuitous; проба (0.0.0.0) — никакую
+    bool gratuitous = operation == kRequest && senderIp == readU32(arp + kTargetIp);
+    if ((operation != kReply && !gratuitous) || senderIp == 0) {
+        return;
+    }
+    uint64_t mac = packMac(arp + kSenderMac);
+    if (mac == 0 || (arp[kSenderMac] & 0x01)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(bindingKey(vlan, senderIp), mac, nowSec());
+}
+
+bool ArpCache::answer(const u_char* frame, int length, uint16_t vlan, const CommutationTable& table,
+                      u_char* reply) {
+    const u_char* arp = arpHeader(frame, length);
+    if (!arp || readU16(arp + kOperation) != kRequest) {
+        return false;
+    }
+    uint32_t senderIp = readU32(arp + kSenderIp);
+    uint32_t targetIp = readU32(arp + kTargetIp);
+    // Gratuitous ARP и пробы (проверка занятости адреса) должны дойти до всех хостов
+    if (senderIp == 0 || senderIp == targetIp) {
+        return false;
+    }
+
+    uint64_t mac;
+    u_char targetMac[6];
+    if (!lookup(bindingKey(vlan, targetIp), mac)) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    unpackMac(mac, targetMac);
+    if (table.getPortForMac(targetMac, vlan) == -1) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Ответ от имени владельца адреса: ему же адресован бы был его ответ
+    memset(reply, 0, kReplyLength);
+    memcpy(reply, arp + kSenderMac, 6);
+    memcpy(reply + 6, targetMac, 6);
+    uint16_t type = htons(ETHERTYPE_ARP);
+    memcpy(reply + 12, &type, sizeof(type));
+    u_char* out = reply + kEth;
+    memcpy(out, arp, kOperation);
+    uint16_t operation = htons(kReply);
+    memcpy(out + kOperation, &operation, sizeof(operation));
+    memcpy(out + kSenderMac, targetMac, 6);
+    memcpy(out + kSenderIp, arp + kTargetIp, 4);
+    memcpy(out + kTargetMac, arp + kSenderMac, 6);
+    memcpy(out + kTargetIp, arp + kSenderIp, 4);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ArpCache::ageEntries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t now = nowSec();
+
+    struct Binding {
+        uint64_t key;
+        uint64_t mac;
+        uint32_t seen;
+    };
+    std::vector<Binding> live;
+    bool expired = false;
+    for (size_t i = 0; i <= mask_; ++i) {
+        uint64_t key = slots_[i].key.load(std::memory_order_relaxed);
+        if (key == 0) {
+            continue;
+        }
+        uint32_t seen = slots_[i].seen.load(std::memory_order_relaxed);
+        if (now - seen >= timeoutSec_) {
+            expired = true;
+        } else {
+            live.push_back({key, slots_[i].mac.load(std::memory_order_relaxed), seen});
+        }
+    }
+    if (!expired) {
+        return;
+    }
+
+    // Открытая адресация не позволяет просто очистить ячейку: перестраиваем таблицу
+    uint32_t version = seq_.load(std::memory_order_relaxed);
+    seq_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i <= mask_; ++i) {
+        slots_[i].key.store(0, std::memory_order_relaxed);
+    }
+    size_.store(0, std::memory_order_relaxed);
+    for (const Binding& binding : live) {
+        insert(binding.key, binding.mac, binding.seen);
+    }
+
+    seq_.store(version + 2, std::memory_order_release);
+}
+
+void ArpCache::printStats() const {
+    uint64_t hits = this->hits();
+    uint64_t misses = this->misses();
+    std::ostringstream out;
+    out << "ARP suppression: " << size() << "/" << capacity_ << " bindings, "
+        << hits << " requests answered, " << misses << " flooded";
+    if (hits + misses) {
+        out << " (" << std::fixed << std::setprecision(1) << 100.0 * double(hits) / double(hits + misses)
+            << "% answered)";
+    }
+    std::cout << out.str() << std::endl;
+}
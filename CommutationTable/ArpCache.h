@@ -0,0 +1,106 @@
+#ifndef ARP_CACHE_H
+#define ARP_CACHE_H
+
+#include "../Headers.h"
+#include "CommutationTable.h"
+
+/**
+ * @class ArpCache
+ * @brief Кэш привязок IPv4 → MAC для подавления рассылки запросов ARP (ARP suppression)
+ *
+ * Привязки запоминаются из ответов ARP и из gratuitous ARP (запрос или ответ,
+ * в котором адрес отправителя совпадает с искомым), проходящих через коммутатор,
+ * отдельно для каждого VLAN.
+ * Широковещательный запрос об известном адресе коммутатор не рассылает во все
+ * порты, а сам отвечает от имени владельца адреса в порт приёма. Ответ даётся,
+ * только пока MAC-адрес владельца есть в таблице коммутации: иначе хост мог
+ * уйти, и запрос рассылается как обычно. Привязка, не подтверждённая новым
+ * ответом за timeout секунд, удаляется (ageEntries()).
+ *
+ * Таблица с открытой адресацией: писатели (обучение и старение) работают под
+ * мьютексом, поиск не берёт блокировку. Ячейка занимается записью ключа
+ * после MAC, поэтому читатель не увидит ячейку без MAC; удаление устаревших
+ * записей перестраивает таблицу под счётчиком версий, и читатель повторяет поиск.
+ */
+class ArpCache {
+public:
+    /// Длина кадра ответа ARP (дополнен до минимального кадра Ethernet)
+    static constexpr int kReplyLength = 60;
+
+    /**
+     * @brief Создаёт пустой кэш
+     * @param capacity Максимальное число привязок
+     * @param timeoutSec Срок привязки без подтверждения, секунды
+     */
+    ArpCache(size_t capacity, uint32_t timeoutSec);
+
+    ArpCache(const ArpCache&) = delete;
+    ArpCache& operator=(const ArpCache&) = delete;
+
+    /**
+     * @brief Запоминает привязку из ответа ARP или gratuitous ARP
+     * @param frame Кадр Ethernet без тега VLAN с EtherType ARP
+     * @param length Длина кадра
+     * @param vlan VLAN кадра
+     */
+    void learn(const u_char* frame, int length, uint16_t vlan);
+
+    /**
+     * @brief Готовит ответ на широковещательный запрос ARP об известном адресе
+     * @param frame Кадр запроса без тега VLAN
+     * @param length Длина кадра
+     * @param vlan VLAN кадра
+     * @param table Таблица коммутации (владелец адреса должен быть в ней в том же VLAN)
+     * @param reply Буфер ответа длиной kReplyLength (без тега VLAN)
+     * @return true, если ответ подготовлен и запрос рассылать не нужно
+     */
+    bool answer(const u_char* frame, int length, uint16_t vlan, const CommutationTable& table, u_char* reply);
+
+    /**
+     * @brief Удаляет привязки старше timeout (раз в секунду)
+     */
+    void ageEntries();
+
+    /**
+     * @brief Выводит число привязок и попадания/промахи запросов
+     */
+    void printStats() const;
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @struct Slot
+     * @brief Ячейка кэша
+     */
+    struct Slot {
+        std::atomic<uint64_t> key{0};  ///< bindingKey(), 0 — пустая ячейка
+        std::atomic<uint64_t> mac{0};  ///< MAC-адрес в младших 48 битах
+        std::atomic<uint32_t> seen{0}; ///< Время последнего подтверждения, секунды от epoch_
+    };
+
+    /**
+     * @brief Ключ привязки: VLAN в старших 32 битах, адрес IPv4 (порядок байт хоста) в младших
+     */
+    static uint64_t bindingKey(uint16_t vlan, uint32_t ip) { return (uint64_t(vlan) << 32) | ip; }
+
+    uint32_t nowSec() const;
+    size_t homeSlot(uint64_t key) const;
+    bool lookup(uint64_t key, uint64_t& mac) const;
+    void insert(uint64_t key, uint64_t mac, uint32_t now);
+
+    size_t capacity_;                              ///< Максимальное число привязок
+    uint32_t timeoutSec_;                          ///< Срок привязки
+    std::chrono::steady_clock::time_point epoch_;  ///< Точка отсчёта времени
+    std::unique_ptr<Slot[]> slots_;                ///< Ячейки (число — степень двойки)
+    size_t mask_ = 0;                              ///< Число ячеек минус 1
+    std::mutex mutex_;                             ///< Для писателей
+    std::atomic<size_t> size_{0};                  ///< Число привязок
+    alignas(64) std::atomic<uint32_t> seq_{0};     ///< Счётчик версий: нечётный во время перестройки
+    alignas(64) std::atomic<uint64_t> hits_{0};    ///< Запросов, на которые ответил коммутатор
+    std::atomic<uint64_t> misses_{0};              ///< Запросов, разосланных во все порты
+};
+
+#endif // ARP_CACHE_H
@@ -1,103 +1,721 @@
 #include "CommutationTable.h"
 #include "NetworkUtils/NetworkUtils.h"
+#include <random>
+
+namespace {
+
+    inline uint64_t rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+
+    /**
+     * @brief SipHash-1-3 одного 64-битного слова (сообщение из 8 байт)
+     * @param k0 Первая половина секрета
+     * @param k1 Вторая половина секрета
+     * @param word Хэшируемое слово
+     */
+    uint64_t sipHash13(uint64_t k0, uint64_t k1, uint64_t word) {
+        uint64_t v0 = 0x736F6D6570736575ull ^ k0;
+        uint64_t v1 = 0x646F72616E646F6Dull ^ k1;
+        uint64_t v2 = 0x6C7967656E657261ull ^ k0;
+        uint64_t v3 = 0x7465646279746573ull ^ k1;
+        v3 ^= word;
+        sipRound(v0, v1, v2, v3);
+        v0 ^= word;
+        // Последний блок: только длина сообщения в старшем байте
+        const uint64_t last = uint64_t(8) << 56;
+        v3 ^= last;
+        sipRound(v0, v1, v2, v3);
+        v0 ^= last;
+        v2 ^= 0xFF;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+} // namespace
 
 /**
  * @brief Конструктор таблицы коммутации
  * @param lifetime Время жизни записей в секундах
+ * @param capacity Максимальное число MAC-адресов в таблице
+ * @param fullPolicy Что делать с новым адресом в заполненной таблице
+ *
+ * Число ячеек — степень двойки не меньше удвоенной ёмкости, так что коэффициент
+ * заполнения не превышает 0.5 и цепочки линейного пробирования остаются короткими.
+ * Узлы колеса таймеров выделяются сразу по одному на запись, а число корзин
+ * больше времени жизни, чтобы срок записи никогда не «обгонял» колесо.
+ * Точка отсчёта времени отстоит от момента создания на время жизни: так
+ * у записей, восстановленных из снимка, время активности остаётся неотрицательным.
+ * Секрет хэш-функции берётся из std::random_device при каждом запуске.
+ */
+CommutationTable::CommutationTable(int lifetime, size_t capacity, FullPolicy fullPolicy)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      fullPolicy_(fullPolicy),
+      learning_(new PortLearning[kMaxLearnPorts + 1]),
+      epoch_(std::chrono::steady_clock::now() - std::chrono::seconds(std::max(lifetime, 0))),
+      agedUpTo_(uint32_t(std::max(lifetime, 0))),
+      maxLifetimeSec_(lifetime),
+      statsShards_(new StatsShard[kMaxStatsShards]),
+      sharedShard_(new StatsShard),
+      prevStatsTime_(std::chrono::steady_clock::now()) {
+    size_t slotCount = 16;
+    unsigned bits = 4;
+    while (slotCount < capacity_ * 2) {
+        slotCount <<= 1;
+        ++bits;
+    }
+    mask_ = slotCount - 1;
+    shift_ = 64 - bits;
+
+    std::random_device random;
+    for (uint64_t& key : hashKey_) {
+        key = (uint64_t(random()) << 32) | random();
+    }
+
+    slots_.reset(new (std::align_val_t(kCacheLine)) Slot[slotCount]);
+
+    nodeKey_.reset(new uint64_t[capacity_]);
+    nodeNext_.reset(new uint32_t[capacity_]);
+    for (size_t i = 0; i < capacity_; ++i) {
+        nodeNext_[i] = i + 1 < capacity_ ? uint32_t(i + 1) : kNil;
+    }
+    freeNodes_ = 0;
+
+    uint32_t wheelSize = 2;
+    while (wheelSize < uint32_t(std::max(maxLifetimeSec_, 0)) + 2) {
+        wheelSize <<= 1;
+    }
+    wheel_.assign(wheelSize, kNil);
+    wheelMask_ = wheelSize - 1;
+}
+
+/**
+ * @brief Текущее время в секундах от создания таблицы
+ */
+uint32_t CommutationTable::nowSec() const {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - epoch_).count());
+}
+
+/**
+ * @brief Начальная ячейка для ключа (старшие биты SipHash с секретом таблицы)
+ *
+ * Мультипликативный хэш без секрета позволял подобрать адреса источника,
+ * которые выстраиваются в одну длинную цепочку и замедляют поиск всех портов.
+ */
+size_t CommutationTable::homeSlot(uint64_t key) const {
+    return static_cast<size_t>(sipHash13(hashKey_[0], hashKey_[1], key) >> shift_);
+}
+
+/**
+ * @brief Ищет ячейку с ключом или первую пустую ячейку цепочки
+ * @param key Ключ с флагом занятости
+ * @return Индекс найденной ячейки
+ * @note Вызывается под мьютексом
+ */
+size_t CommutationTable::findSlot(uint64_t key) const {
+    size_t i = homeSlot(key);
+    uint64_t k;
+    while ((k = slots_[i].key.load(std::memory_order_relaxed)) != 0 && k != key) {
+        i = (i + 1) & mask_;
+    }
+    return i;
+}
+
+/**
+ * @brief Поиск без блокировки
+ * @param key Ключ с флагом занятости
+ *
+ * Читатель повторяет поиск, если во время него писатель перемещал записи
+ * (счётчик версий нечётный или изменился). Добавление записи в пустую ячейку
+ * версию не меняет: ключ публикуется последним с release-семантикой.
+ */
+CommutationTable::Lookup CommutationTable::lookup(uint64_t key) const {
+    for (;;) {
+        uint32_t version = seq_.load(std::memory_order_acquire);
+        if (version & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        Lookup result{0, -1};
+        size_t i = homeSlot(key);
+        for (size_t probes = 0; probes <= mask_; ++probes) {
+            uint64_t k = slots_[i].key.load(std::memory_order_acquire);
+            if (k == 0) {
+                break;
+            }
+            if (k == key) {
+                result = {i, slots_[i].port.load(std::memory_order_relaxed)};
+                break;
+            }
+            i = (i + 1) & mask_;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == version) {
+            return result;
+        }
+    }
+}
+
+/**
+ * @brief Переносит запись из ячейки from в ячейку to
+ * @note Вызывается под мьютексом при нечётном счётчике версий
  */
-CommutationTable::CommutationTable(int lifetime) : maxLifetimeSec_(lifetime) {}
+void CommutationTable::moveSlot(size_t to, size_t from) {
+    slots_[to].port.store(slots_[from].port.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slots_[to].lastSeen.store(slots_[from].lastSeen.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slots_[to].key.store(slots_[from].key.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Удаляет запись обратным сдвигом, не оставляя «надгробий»
+ * @param index Индекс занятой ячейки
+ *
+ * Записи, стоящие за удалённой в той же цепочке, сдвигаются назад,
+ * если их начальная ячейка не лежит между освободившейся ячейкой и текущей позицией.
+ * Вызывается под мьютексом; на время сдвига счётчик версий становится нечётным.
+ */
+void CommutationTable::eraseSlot(size_t index) {
+    std::atomic<uint32_t>& entries = learning(slots_[index].port.load(std::memory_order_relaxed)).entries;
+    entries.store(entries.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+    uint32_t version = seq_.load(std::memory_order_relaxed);
+    seq_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t hole = index;
+    size_t i = (index + 1) & mask_;
+    uint64_t k;
+    while ((k = slots_[i].key.load(std::memory_order_relaxed)) != 0) {
+        size_t home = homeSlot(k);
+        // Расстояние от начальной ячейки до текущей и до «дыры» по кольцу
+        if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+            moveSlot(hole, i);
+            hole = i;
+        }
+        i = (i + 1) & mask_;
+    }
+    slots_[hole].key.store(0, std::memory_order_relaxed);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+
+    seq_.store(version + 2, std::memory_order_release);
+}
 
 /**
  * @brief Обновляет или добавляет запись в таблицу
  * @param mac Указатель на MAC-адрес
  * @param port Номер порта для обновления
+ * @param vlan VLAN кадра
+ * @return Индекс записи или kNoEntry, если адрес не выучен
+ *
+ * Если адрес уже известен на этом порту, обновляется только время активности
+ * (не чаще раза в секунду) без блокировки. Если запись успела переместиться при
+ * удалении соседней, время может достаться другой записи — это лишь продлит её жизнь.
+ *
+ * Новый адрес и смена порта сначала проверяются по ограничениям порта без
+ * мьютекса: порт, засыпающий коммутатор случайными адресами, получает отказ,
+ * не задерживая обучение на других портах. Под мьютексом проверка повторяется.
  */
-void CommutationTable::updateEntry(const u_char* mac, int port) {
-    std::string macStr = utils::macToString(mac);
+size_t CommutationTable::updateEntry(const u_char* mac, int port, uint16_t vlan) {
+    const uint64_t key = makeKey(utils::macToU64(mac), vlan);
+    const uint32_t now = nowSec();
+
+    Lookup found = lookup(key);
+    if (found.port == port) {
+        Slot& slot = slots_[found.index];
+        if (slot.lastSeen.load(std::memory_order_relaxed) != now) {
+            slot.lastSeen.store(now, std::memory_order_relaxed);
+        }
+        return found.index;
+    }
+
+    PortLearning& portLearning = learning(port);
+    if (!learnAllowed(portLearning, now) ||
+        (found.port == -1 && fullPolicy_ == FullPolicy::Reject && size_.load(std::memory_order_relaxed) >= capacity_)) {
+        portLearning.rejected.fetch_add(1, std::memory_order_relaxed);
+        return kNoEntry;
+    }
+
     std::lock_guard<std::mutex> lock(mutex_);
-    macTable_[macStr] = {port, std::chrono::steady_clock::now()};
+    size_t i = findSlot(key);
+    const bool isNew = slots_[i].key.load(std::memory_order_relaxed) == 0;
+    const int oldPort = isNew ? -1 : slots_[i].port.load(std::memory_order_relaxed);
+    if (oldPort == port) {
+        slots_[i].lastSeen.store(now, std::memory_order_relaxed);
+        return i;
+    }
+    if (!learnAllowed(portLearning, now)) {
+        portLearning.rejected.fetch_add(1, std::memory_order_relaxed);
+        return kNoEntry;
+    }
+    if (isNew && size_.load(std::memory_order_relaxed) >= capacity_) {
+        if (fullPolicy_ == FullPolicy::Reject || !evictOldest()) {
+            portLearning.rejected.fetch_add(1, std::memory_order_relaxed);
+            return kNoEntry;
+        }
+        // Вытеснение сдвигает записи: ищем свободную ячейку заново
+        i = findSlot(key);
+    }
+
+    // Обучения за текущую секунду (окно сбрасывается с новой секундой)
+    if (portLearning.window.load(std::memory_order_relaxed) != now) {
+        portLearning.learns.store(0, std::memory_order_relaxed);
+        portLearning.window.store(now, std::memory_order_relaxed);
+    }
+    portLearning.learns.store(portLearning.learns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    Slot& slot = slots_[i];
+    if (isNew) {
+        insertSlot(i, key, port, now);
+        learned_.store(learned_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        std::atomic<uint32_t>& oldEntries = learning(oldPort).entries;
+        oldEntries.store(oldEntries.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        portLearning.entries.store(portLearning.entries.load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+        slot.port.store(port, std::memory_order_relaxed);
+        slot.lastSeen.store(now, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+        moved_.store(moved_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    return i;
+}
+
+/**
+ * @brief Разрешают ли ограничения порта новый адрес или смену порта
+ * @param learning Ограничения и счётчики порта
+ * @param now Текущая секунда
+ * @note Читает счётчики без мьютекса; под мьютексом результат точный
+ */
+bool CommutationTable::learnAllowed(const PortLearning& learning, uint32_t now) {
+    const LearnLimits& limits = learning.limits;
+    if (limits.maxEntries && learning.entries.load(std::memory_order_relaxed) >= limits.maxEntries) {
+        return false;
+    }
+    return !limits.perSecond || learning.window.load(std::memory_order_relaxed) != now ||
+           learning.learns.load(std::memory_order_relaxed) < limits.perSecond;
+}
+
+/**
+ * @brief Вытесняет запись, дольше всех не проявлявшую активность
+ * @return false, если за kAgingBatch просмотренных узлов вытеснить ничего не удалось
+ * @note Вызывается под мьютексом
+ *
+ * Корзины колеса таймеров просматриваются по возрастанию срока, поэтому первая
+ * запись, не обновлявшаяся после постановки в свою корзину, — самая давняя
+ * с точностью до секунды. Записи, которые были активны позже, по пути переносятся
+ * в корзины своих настоящих сроков (эту работу иначе сделал бы ageEntries()).
+ */
+bool CommutationTable::evictOldest() {
+    const uint32_t lifetime = uint32_t(std::max(maxLifetimeSec_, 0));
+    size_t inspected = 0;
+    for (uint32_t t = 1; t <= wheelMask_ + 1 && inspected < kAgingBatch; ++t) {
+        const uint32_t bucket = agedUpTo_ + t;
+        uint32_t& head = wheel_[bucket & wheelMask_];
+        while (head != kNil && inspected < kAgingBatch) {
+            ++inspected;
+            uint32_t node = head;
+            head = nodeNext_[node];
+            size_t i = findSlot(nodeKey_[node]);
+            uint32_t lastSeen = slots_[i].lastSeen.load(std::memory_order_relaxed);
+            if (lastSeen + lifetime <= bucket) {
+                eraseSlot(i);
+                evicted_.store(evicted_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                nodeNext_[node] = freeNodes_;
+                freeNodes_ = node;
+                return true;
+            }
+            scheduleNode(node, lastSeen + lifetime);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Заполняет пустую ячейку и ставит запись в колесо таймеров
+ * @param index Пустая ячейка цепочки ключа (из findSlot)
+ * @param key Ключ с флагом занятости
+ * @param port Номер порта
+ * @param lastSeen Время последней активности
+ * @note Вызывается под мьютексом, когда в таблице есть место
+ */
+void CommutationTable::insertSlot(size_t index, uint64_t key, int port, uint32_t lastSeen) {
+    Slot& slot = slots_[index];
+    slot.port.store(port, std::memory_order_relaxed);
+    slot.lastSeen.store(lastSeen, std::memory_order_relaxed);
+    // Публикуем ключ последним, чтобы читатель увидел заполненную ячейку
+    slot.key.store(key, std::memory_order_release);
+    size_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic<uint32_t>& entries = learning(port).entries;
+    entries.store(entries.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // Узлов столько же, сколько записей, поэтому свободный узел всегда есть
+    uint32_t node = freeNodes_;
+    freeNodes_ = nodeNext_[node];
+    nodeKey_[node] = key;
+    scheduleNode(node, lastSeen + uint32_t(std::max(maxLifetimeSec_, 0)));
+
+    // Счётчик меняется после публикации ключа: кэш, увидевший новое значение, увидит и запись
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Добавляет запись с заданным возрастом (восстановление из снимка)
+ * @param mac MAC-адрес (младшие 48 бит)
+ * @param port Номер порта
+ * @param ageSec Секунд с последней активности
+ * @param vlan VLAN
+ * @return false, если адрес уже есть в таблице, таблица заполнена или порт исчерпал ограничение
+ *
+ * Отказ по ограничению порта учитывается в его счётчике отказов, как и при обучении.
+ * Лимит скорости обучения восстановление не расходует.
+ */
+bool CommutationTable::restoreEntry(uint64_t mac, int port, uint32_t ageSec, uint16_t vlan) {
+    const uint64_t key = makeKey(mac, vlan);
+    const uint32_t now = nowSec();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t i = findSlot(key);
+    if (slots_[i].key.load(std::memory_order_relaxed) != 0 || size_.load(std::memory_order_relaxed) >= capacity_) {
+        return false;
+    }
+    PortLearning& portLearning = learning(port);
+    if (!learnAllowed(portLearning, now)) {
+        portLearning.rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    insertSlot(i, key, port, now - std::min(ageSec, now));
+    return true;
+}
+
+/**
+ * @brief Возвращает копию всех записей
+ */
+std::vector<CommutationTable::EntryInfo> CommutationTable::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<EntryInfo> result;
+    result.reserve(size());
+    const uint32_t now = nowSec();
+    for (size_t i = 0; i <= mask_; ++i) {
+        uint64_t key = slots_[i].key.load(std::memory_order_relaxed);
+        if (key == 0) {
+            continue;
+        }
+        uint32_t lastSeen = slots_[i].lastSeen.load(std::memory_order_relaxed);
+        result.push_back({key & kMacMask, uint16_t((key >> 48) & 0x0FFF),
+                          slots_[i].port.load(std::memory_order_relaxed),
+                          now > lastSeen ? now - lastSeen : 0});
+    }
+    return result;
 }
 
 /**
  * @brief Возвращает порт для указанного MAC-адреса
  * @param mac Указатель на MAC-адрес
+ * @param vlan VLAN, в котором ищется адрес
  * @return Номер порта или -1 если не найден
  */
-int CommutationTable::getPortForMac(const u_char* mac) const {
-    std::string macStr = utils::macToString(mac);
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = macTable_.find(macStr);
-    return it != macTable_.end() ? it->second.port : -1;
+int CommutationTable::getPortForMac(const u_char* mac, uint16_t vlan) const {
+    return lookup(makeKey(utils::macToU64(mac), vlan)).port;
+}
+
+/**
+ * @brief Обновляет время активности записи по индексу
+ * @param index Индекс ячейки
+ * @param now Текущее время
+ *
+ * Как и в updateEntry(), время пишется не чаще раза в секунду; если запись
+ * успела переместиться, время достанется соседней записи и лишь продлит её жизнь.
+ */
+void CommutationTable::touchEntry(size_t index, std::chrono::steady_clock::time_point now) {
+    const uint32_t sec = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(now - epoch_).count());
+    Slot& slot = slots_[index];
+    if (slot.lastSeen.load(std::memory_order_relaxed) != sec) {
+        slot.lastSeen.store(sec, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Ставит узел в корзину колеса таймеров
+ * @param node Индекс узла
+ * @param deadline Секунда, когда запись может устареть
+ * @note Вызывается под мьютексом. Срок в уже обработанном прошлом переносится на следующий такт.
+ */
+void CommutationTable::scheduleNode(uint32_t node, uint32_t deadline) {
+    deadline = std::max(deadline, agedUpTo_ + 1);
+    uint32_t& head = wheel_[deadline & wheelMask_];
+    nodeNext_[node] = head;
+    head = node;
+}
+
+/**
+ * @brief Проверяет порцию узлов отсоединённой корзины
+ * @param node Первый узел списка
+ * @param now Текущая секунда
+ * @param limit Максимальное число узлов за вызов
+ * @return Первый необработанный узел или kNil
+ * @note Вызывается под мьютексом
+ *
+ * Устаревшая запись удаляется, а её узел освобождается. Запись, которая была
+ * активна после постановки в колесо, переносится в корзину своего нового срока.
+ */
+uint32_t CommutationTable::expireNodes(uint32_t node, uint32_t now, size_t limit) {
+    const uint32_t lifetime = uint32_t(std::max(maxLifetimeSec_, 0));
+    for (size_t n = 0; n < limit && node != kNil; ++n) {
+        uint32_t next = nodeNext_[node];
+        size_t i = findSlot(nodeKey_[node]);
+        uint32_t lastSeen = slots_[i].lastSeen.load(std::memory_order_relaxed);
+
+        // Время могло обновиться уже после того, как была взята секунда now
+        if (int64_t(now) - int64_t(lastSeen) >= int64_t(lifetime)) {
+            eraseSlot(i);
+            aged_.store(aged_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            nodeNext_[node] = freeNodes_;
+            freeNodes_ = node;
+        } else {
+            scheduleNode(node, lastSeen + lifetime);
+        }
+        node = next;
+    }
+    return node;
 }
 
 /**
  * @brief Удаляет устаревшие записи из таблицы
+ *
+ * Обрабатывает корзины всех секунд, прошедших с прошлого вызова (но не больше
+ * одного оборота колеса). Корзина отсоединяется целиком и разбирается порциями,
+ * так что писатели ждут мьютекс не дольше обработки kAgingBatch записей.
  */
 void CommutationTable::ageEntries() {
-    auto now = std::chrono::steady_clock::now();
-    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t now = nowSec();
+    uint32_t first;
+    uint32_t ticks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (now <= agedUpTo_) {
+            return;
+        }
+        first = agedUpTo_ + 1;
+        ticks = std::min(now - agedUpTo_, wheelMask_ + 1);
+        agedUpTo_ = now;
+    }
 
-    for (auto it = macTable_.begin(); it != macTable_.end();) {
-        auto age = std::chrono::duration_cast<std::chrono::seconds>(now - it->second.lastSeen).count();
-        if (age >= maxLifetimeSec_) {
-            it = macTable_.erase(it);
-        } else {
-            ++it;
+    for (uint32_t t = 0; t < ticks; ++t) {
+        uint32_t node;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint32_t& head = wheel_[(first + t) & wheelMask_];
+            node = head;
+            head = kNil;
+        }
+        while (node != kNil) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            node = expireNodes(node, now, kAgingBatch);
         }
     }
 }
 
+/**
+ * @brief Возвращает счётчики событий таблицы
+ */
+CommutationTable::Counters CommutationTable::counters() const {
+    Counters c;
+    c.learned = learned_.load(std::memory_order_relaxed);
+    c.moved = moved_.load(std::memory_order_relaxed);
+    c.aged = aged_.load(std::memory_order_relaxed);
+    c.evicted = evicted_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= kMaxLearnPorts; ++i) {
+        c.rejected += learning_[i].rejected.load(std::memory_order_relaxed);
+    }
+    return c;
+}
+
+/**
+ * @brief Задаёт ограничения обучения порта
+ */
+void CommutationTable::setLearnLimits(int port, const LearnLimits& limits) {
+    if (port >= 0 && size_t(port) < kMaxLearnPorts) {
+        learning_[port].limits = limits;
+    }
+}
+
+/**
+ * @brief Возвращает число записей и отказов в обучении порта
+ */
+CommutationTable::PortLearnStats CommutationTable::portLearnStats(int port) const {
+    const PortLearning& portLearning = learning(port);
+    PortLearnStats stats;
+    stats.entries = portLearning.entries.load(std::memory_order_relaxed);
+    stats.rejected = portLearning.rejected.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Возвращает текущее число записей в таблице
+ */
+size_t CommutationTable::size() const {
+    return size_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает гистограмму текущего потока для порта
+ * @param port Номер порта
+ *
+ * Поток запоминает свои гистограммы в thread_local-списке, так что свободная
+ * гистограмма захватывается один раз на пару «поток, порт». Ключ списка — номер
+ * таблицы, а не адрес: новая таблица по адресу удалённой не получит её гистограмм.
+ */
+CommutationTable::StatsShard* CommutationTable::statsShard(int port) {
+    struct ShardRef {
+        uint64_t table;
+        int port;
+        StatsShard* shard;
+    };
+    thread_local std::vector<ShardRef> cache;
+
+    for (const auto& ref : cache) {
+        if (ref.table == id_ && ref.port == port) {
+            return ref.shard;
+        }
+    }
+
+    size_t index = statsShardCount_.fetch_add(1, std::memory_order_relaxed);
+    StatsShard* shard = nullptr;
+    if (index < kMaxStatsShards) {
+        shard = &statsShards_[index];
+        shard->port.store(port, std::memory_order_release);
+    }
+    cache.push_back({id_, port, shard});
+    return shard;
+}
+
 /**
  * @brief Обновляет статистику обработки пакетов
- * @param duration Время обработки пакета в миллисекундах
+ * @param port Номер порта, на котором принят пакет
+ * @param durationNs Время обработки пакета в наносекундах
  */
-void CommutationTable::updateStats(double duration) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    processingTimes_.push_back(duration);
-    if (duration > maxProcessingTime_) {
-        maxProcessingTime_ = duration;
+void CommutationTable::updateStats(int port, uint64_t durationNs) {
+    StatsShard* shard = statsShard(port);
+    if (shard) {
+        shard->histogram.record(durationNs);
+    } else {
+        sharedShard_->histogram.recordShared(durationNs);
     }
-    totalPackets_++;
 }
 
 /**
  * @brief Выводит текущее состояние таблицы
+ *
+ * Записи копируются под мьютексом, форматирование идёт уже без него,
+ * поэтому обучение не ждёт вывода в консоль.
  */
 void CommutationTable::printTable() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::cout << "\n=== MAC Table (" << macTable_.size() << " entries) ===" << std::endl;
-    std::cout << std::left << std::setw(20) << "MAC Address"
-              << std::setw(10) << "Port"
-              << "Age (sec)" << std::endl;
-
-    auto now = std::chrono::steady_clock::now();
-    for (const auto& entry : macTable_) {
-        auto age = std::chrono::duration_cast<std::chrono::seconds>(now - entry.second.lastSeen).count();
-        std::cout << std::left << std::setw(20) << entry.first
-                  << std::setw(10) << entry.second.port
-                  << age << std::endl;
+    std::vector<EntryInfo> snapshot = entries();
+    std::ostringstream out;
+    out << "\n=== MAC Table (" << snapshot.size() << " entries) ===\n";
+    out << std::left << std::setw(20) << "MAC Address"
+        << std::setw(8) << "VLAN"
+        << std::setw(10) << "Port"
+        << "Age (sec)\n";
+    for (const auto& entry : snapshot) {
+        out << std::left << std::setw(20) << utils::macToString(entry.mac)
+            << std::setw(8) << entry.vlan
+            << std::setw(10) << entry.port
+            << entry.ageSec << "\n";
     }
-    std::cout << "=============================" << std::endl;
+    out << "=============================";
+    std::cout << out.str() << std::endl;
 }
 
 
+/**
+ * @brief Объединяет гистограммы задержек по портам и в целом
+ *
+ * Гистограммы читаются без блокировки.
+ */
+void CommutationTable::latency(std::map<int, LatencyHistogram::Snapshot>& perPort,
+                               LatencyHistogram::Snapshot& overall) const {
+    size_t shards = std::min(statsShardCount_.load(std::memory_order_relaxed), kMaxStatsShards);
+    for (size_t i = 0; i < shards; ++i) {
+        int port = statsShards_[i].port.load(std::memory_order_acquire);
+        if (port < 0) {
+            continue;
+        }
+        statsShards_[i].histogram.addTo(perPort[port]);
+    }
+    for (const auto& entry : perPort) {
+        overall.merge(entry.second);
+    }
+    // Общая гистограмма не различает порты и учитывается только в итоге
+    sharedShard_->histogram.addTo(overall);
+}
+
 /**
  * @brief Выводит статистику обработки пакетов
+ *
+ * Скорость считается по разнице числа пакетов с прошлого вызова.
  */
 void CommutationTable::printStats() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    double avg = 0;
-    if (!processingTimes_.empty()) {
-        for (auto t : processingTimes_) {
-            avg += t;
+    std::map<int, LatencyHistogram::Snapshot> perPort;
+    LatencyHistogram::Snapshot overall;
+    latency(perPort, overall);
+
+    // Строки собираются в буфер, в консоль выводятся уже без мьютекса
+    std::ostringstream out;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - prevStatsTime_).count();
+        prevStatsTime_ = now;
+
+        auto printRow = [elapsed, &out](const std::string& name, const LatencyHistogram::Snapshot& snapshot,
+                                        uint64_t prevTotal) {
+            auto us = [](uint64_t ns) { return double(ns) / 1000.0; };
+            double pps = elapsed > 0 ? double(snapshot.total - prevTotal) / elapsed : 0;
+            out << std::left << std::setw(8) << name
+                << std::right << std::setw(12) << snapshot.total
+                << std::setw(12) << uint64_t(pps)
+                << std::fixed << std::setprecision(2)
+                << std::setw(10) << us(snapshot.percentile(50))
+                << std::setw(10) << us(snapshot.percentile(90))
+                << std::setw(10) << us(snapshot.percentile(99))
+                << std::setw(10) << us(snapshot.percentile(99.9))
+                << std::setw(10) << us(snapshot.max)
+                << std::defaultfloat << "\n";
+        };
+
+        out << "\n=== Statistics (latency in us) ===\n"
+            << std::left << std::setw(8) << "Port"
+            << std::right << std::setw(12) << "Packets" << std::setw(12) << "pps"
+            << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+            << std::setw(10) << "p99.9" << std::setw(10) << "max" << "\n";
+        for (const auto& entry : perPort) {
+            uint64_t& prev = prevPackets_[entry.first];
+            printRow(std::to_string(entry.first), entry.second, prev);
+            prev = entry.second.total;
         }
-        avg /= processingTimes_.size();
+        uint64_t& prevTotal = prevPackets_[-1];
+        printRow("all", overall, prevTotal);
+        prevTotal = overall.total;
     }
 
-    std::cout << "\n=== Statistics ==="
-              << "\nTotal packets: " << totalPackets_
-              << "\nAverage process time: " << avg << " ms"
-              << "\nMax process time: " << maxProcessingTime_ << " ms"
-              << "\nMAC table size: " << macTable_.size() << " entries"
-              << "\n==================" << std::endl;
+    Counters events = counters();
+    out << "MAC table size: " << size() << " entries (learned " << events.learned << ", moved "
+        << events.moved << ", aged " << events.aged << ", evicted " << events.evicted
+        << ", rejected " << events.rejected << ")"
+        << "\n==================";
+    std::cout << out.str() << std::endl;
 }
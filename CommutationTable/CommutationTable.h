@@ -2,12 +2,42 @@
 #define COMMUTATION_TABLE_H
 
 #include "../Headers.h"
+#include "LatencyHistogram.h"
+#include <memory>
+#include <new>
 
 /**
  * @class CommutationTable
  * @brief Класс для управления таблицей коммутации сетевых устройств
  *
- * Обеспечивает хранение и обновление MAC-адресов, портов и статистики обработки пакетов
+ * Обеспечивает хранение и обновление MAC-адресов, портов и статистики обработки пакетов.
+ * Таблица MAC-адресов — хэш-таблица с открытой адресацией фиксированной ёмкости:
+ * ключом служит пара (VLAN, MAC), упакованная в uint64_t, поэтому один адрес
+ * в разных VLAN — разные записи. Все ячейки выделяются в конструкторе,
+ * поэтому обучение и поиск не выделяют память.
+ *
+ * Начальная ячейка адреса — SipHash-1-3 ключа со случайным секретом процесса:
+ * подобрать адреса, попадающие в одну цепочку пробирования, по известной
+ * хэш-функции нельзя. Когда таблица заполнена, новый адрес вытесняет запись,
+ * дольше всех не проявлявшую активность (FullPolicy::EvictOldest), или не
+ * запоминается (FullPolicy::Reject). Число адресов порта и число обучений
+ * на порту за секунду можно ограничить (setLearnLimits()): поток случайных
+ * адресов источника с одного порта не вытесняет адреса других портов,
+ * а отказы проверяются без мьютекса и считаются по портам.
+ *
+ * Чтение не берёт блокировку: поиск защищён счётчиком версий (seqlock), который
+ * меняется только при удалении записей, и не выполняет атомарных RMW-операций.
+ * Повторное обучение адреса на том же порту лишь обновляет время активности.
+ * Мьютекс нужен только для добавления адреса, смены порта и удаления.
+ *
+ * Старение записей выполняет колесо таймеров с шагом в одну секунду: каждая
+ * запись стоит в корзине секунды, когда она может устареть, и за такт
+ * просматривается только одна корзина. Колесо покрывает всё время жизни,
+ * поэтому хватает одного уровня без каскадного переноса.
+ *
+ * Статистика задержек ведётся в гистограммах LatencyHistogram: у каждой пары
+ * «поток, порт» своя гистограмма, при выводе они объединяются. Память под
+ * статистику постоянна и выделяется в конструкторе.
  */
 class CommutationTable {
 public:
@@ -20,56 +50,341 @@ public:
         std::chrono::steady_clock::time_point lastSeen; ///< Время последней активности
     };
 
+    /// VLAN кадров коммутатора без настройки VLAN
+    static constexpr uint16_t kDefaultVlan = 1;
+    /// Ёмкость таблицы по умолчанию (число MAC-адресов)
+    static constexpr size_t kDefaultCapacity = 16384;
+    /// Число записей колеса таймеров, обрабатываемых за одно взятие мьютекса
+    static constexpr size_t kAgingBatch = 256;
+    /// Число гистограмм статистики (пар «поток, порт»); остальные пары пишут в общую
+    static constexpr size_t kMaxStatsShards = 128;
+    /// Число портов с ограничениями обучения; остальные порты учатся без ограничений
+    static constexpr size_t kMaxLearnPorts = 256;
+
+    /**
+     * @enum FullPolicy
+     * @brief Что делать с новым адресом, когда таблица заполнена
+     */
+    enum class FullPolicy {
+        EvictOldest, ///< Вытеснить запись, дольше всех не проявлявшую активность
+        Reject,      ///< Не запоминать новый адрес
+    };
+
     /**
      * @brief Конструктор таблицы коммутации
      * @param lifetime Время жизни записей в секундах
+     * @param capacity Максимальное число MAC-адресов в таблице
+     * @param fullPolicy Что делать с новым адресом в заполненной таблице
      */
-    CommutationTable(int lifetime);
+    CommutationTable(int lifetime, size_t capacity = kDefaultCapacity,
+                     FullPolicy fullPolicy = FullPolicy::EvictOldest);
+
+    /// Индекс записи, которой нет в таблице
+    static constexpr size_t kNoEntry = SIZE_MAX;
 
     /**
      * @brief Обновляет или добавляет запись в таблицу
      * @param mac Указатель на MAC-адрес
      * @param port Номер порта для обновления
+     * @param vlan VLAN кадра
+     * @return Индекс записи для touchEntry() или kNoEntry, если адрес не выучен
+     * @note Если адрес уже известен на этом порту, обновляется только время активности
+     *       без блокировки. Новый адрес или смена порта не запоминаются, если порт
+     *       исчерпал ограничения обучения или таблица заполнена и вытеснять нельзя.
      */
-    void updateEntry(const u_char* mac, int port);
+    size_t updateEntry(const u_char* mac, int port, uint16_t vlan = kDefaultVlan);
 
     /**
      * @brief Возвращает порт для указанного MAC-адреса
      * @param mac Указатель на MAC-адрес
+     * @param vlan VLAN, в котором ищется адрес
      * @return Номер порта или -1 если не найден
+     * @note Не берёт блокировку и не выполняет атомарных RMW-операций
+     */
+    int getPortForMac(const u_char* mac, uint16_t vlan = kDefaultVlan) const;
+
+    /**
+     * @brief Возвращает счётчик изменений таблицы
+     *
+     * Меняется при добавлении адреса, смене его порта и удалении записи, но не
+     * при обновлении времени активности. Пока он прежний, результаты поиска
+     * и индексы записей (из updateEntry()) остаются верными — на этом держится
+     * кэш решений FlowCache.
+     */
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Обновляет время активности записи по индексу (повторное обучение без поиска)
+     * @param index Индекс из updateEntry(), действителен, пока не изменился generation()
+     * @param now Текущее время
+     * @note Не берёт блокировку, как и обновление времени в updateEntry()
+     */
+    void touchEntry(size_t index, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @struct EntryInfo
+     * @brief Копия записи таблицы (для снимка)
+     */
+    struct EntryInfo {
+        uint64_t mac;    ///< MAC-адрес (младшие 48 бит)
+        uint16_t vlan;   ///< VLAN
+        int port;        ///< Номер порта
+        uint32_t ageSec; ///< Секунд с последней активности
+    };
+
+    /**
+     * @brief Возвращает копию всех записей
+     * @note Берёт мьютекс писателей на время обхода ячеек
      */
-    int getPortForMac(const u_char* mac) const;
+    std::vector<EntryInfo> entries() const;
+
+    /**
+     * @brief Добавляет запись с заданным возрастом (восстановление из снимка)
+     * @param mac MAC-адрес (младшие 48 бит)
+     * @param port Номер порта
+     * @param ageSec Секунд с последней активности, меньше времени жизни
+     * @param vlan VLAN
+     * @return false, если адрес уже известен (выученная запись новее), таблица заполнена
+     *         или порт достиг ограничения числа адресов (отказ учитывается в portLearnStats())
+     */
+    bool restoreEntry(uint64_t mac, int port, uint32_t ageSec, uint16_t vlan = kDefaultVlan);
+
+    /**
+     * @struct LearnLimits
+     * @brief Ограничения обучения на порту (0 — без ограничения)
+     */
+    struct LearnLimits {
+        uint32_t maxEntries = 0; ///< Наибольшее число адресов порта
+        uint32_t perSecond = 0;  ///< Наибольшее число новых адресов и смен порта за секунду
+    };
+
+    /**
+     * @brief Задаёт ограничения обучения порта
+     * @param port Номер порта меньше kMaxLearnPorts
+     * @param limits Ограничения
+     * @note Вызывается до запуска потоков захвата
+     */
+    void setLearnLimits(int port, const LearnLimits& limits);
+
+    /**
+     * @struct PortLearnStats
+     * @brief Записи и отказы в обучении порта
+     */
+    struct PortLearnStats {
+        uint32_t entries = 0;  ///< Адресов порта в таблице
+        uint64_t rejected = 0; ///< Отказов в обучении (ограничения порта или заполненная таблица)
+    };
+
+    /**
+     * @brief Возвращает число записей и отказов в обучении порта
+     */
+    PortLearnStats portLearnStats(int port) const;
+
+    /**
+     * @brief Возвращает время жизни записей в секундах
+     */
+    int lifetime() const { return maxLifetimeSec_; }
 
     /**
      * @brief Удаляет устаревшие записи из таблицы
+     *
+     * Просматривает только корзины колеса таймеров, срок которых наступил.
+     * Записи обрабатываются порциями по kAgingBatch, мьютекс писателей
+     * отпускается между порциями.
      */
     void ageEntries();
 
     /**
      * @brief Обновляет статистику обработки пакетов
-     * @param duration Время обработки пакета в миллисекундах
+     * @param port Номер порта, на котором принят пакет
+     * @param durationNs Время обработки пакета в наносекундах
+     * @note Вызывается один раз на кадр. Не берёт блокировок, кроме первого вызова
+     *       в потоке для нового порта.
+     */
+    void updateStats(int port, uint64_t durationNs);
+
+    /**
+     * @brief Объединяет гистограммы задержек
+     * @param perPort Гистограммы по портам (добавляются к переданным)
+     * @param overall Общая гистограмма
+     * @note Читает гистограммы без блокировок
      */
-    void updateStats(double duration);
+    void latency(std::map<int, LatencyHistogram::Snapshot>& perPort, LatencyHistogram::Snapshot& overall) const;
+
+    /**
+     * @struct Counters
+     * @brief События таблицы с момента создания
+     */
+    struct Counters {
+        uint64_t learned = 0; ///< Выучено новых адресов
+        uint64_t moved = 0;   ///< Адрес перешёл на другой порт
+        uint64_t aged = 0;    ///< Удалено устаревших записей
+        uint64_t evicted = 0; ///< Вытеснено записей из заполненной таблицы
+        uint64_t rejected = 0; ///< Отказов в обучении по всем портам
+    };
+
+    /**
+     * @brief Возвращает счётчики событий таблицы
+     */
+    Counters counters() const;
 
     /**
      * @brief Выводит текущее состояние таблицы
+     * @note Мьютекс писателей берётся только на копирование записей, вывод идёт без него
      */
     void printTable() const;
 
     /**
      * @brief Выводит статистику обработки пакетов
+     *
+     * Для каждого порта и в целом выводит число пакетов, скорость (пакетов в секунду
+     * с прошлого вывода) и перцентили задержки p50/p90/p99/p99.9/max.
      */
     void printStats() const;
 
+    /**
+     * @brief Возвращает текущее число записей в таблице
+     */
+    size_t size() const;
+
+    /**
+     * @brief Возвращает максимальное число записей в таблице
+     */
+    size_t capacity() const { return capacity_; }
+
 private:
-    std::unordered_map<std::string, TableEntry> macTable_; ///< Хэш-таблица MAC-адресов
-    mutable std::mutex mutex_;                             ///< Мьютекс для потокобезопасного доступа
-    int maxLifetimeSec_;                                   ///< Максимальное время жизни записи в секундах
+    /**
+     * @struct Slot
+     * @brief Ячейка хэш-таблицы (16 байт, по 4 ячейки в строке кэша)
+     *
+     * Поля атомарны, чтобы читатели могли обращаться к ним без блокировки.
+     * Порт и время меняются только под мьютексом, кроме обновления времени
+     * при повторном обучении.
+     */
+    struct Slot {
+        std::atomic<uint64_t> key{0};      ///< Ключ makeKey(), 0 — пустая ячейка
+        std::atomic<int32_t> port{0};      ///< Номер порта
+        std::atomic<uint32_t> lastSeen{0}; ///< Время последней активности (секунды от epoch_)
+    };
+
+    /// Флаг занятой ячейки (старший бит ключа, MAC занимает младшие 48 бит, VLAN — биты 48–59)
+    static constexpr uint64_t kOccupied = 1ull << 63;
+    /// Маска MAC-адреса в ключе
+    static constexpr uint64_t kMacMask = 0xFFFFFFFFFFFFull;
+
+    /**
+     * @brief Ключ ячейки для пары (VLAN, MAC)
+     */
+    static uint64_t makeKey(uint64_t mac, uint16_t vlan) {
+        return (mac & kMacMask) | (uint64_t(vlan & 0x0FFF) << 48) | kOccupied;
+    }
+    /// Размер строки кэша
+    static constexpr size_t kCacheLine = 64;
+
+    /**
+     * @brief Освобождает выровненный массив ячеек
+     */
+    struct SlotDeleter {
+        void operator()(Slot* p) const { ::operator delete[](p, std::align_val_t(kCacheLine)); }
+    };
+
+    /**
+     * @brief Результат поиска без блокировки
+     */
+    struct Lookup {
+        size_t index; ///< Индекс ячейки (действителен, только если port != -1)
+        int port;     ///< Порт записи или -1, если адрес не найден
+    };
+
+    uint32_t nowSec() const;
+    size_t homeSlot(uint64_t key) const;
+    size_t findSlot(uint64_t key) const;
+    Lookup lookup(uint64_t key) const;
+    void moveSlot(size_t to, size_t from);
+    void eraseSlot(size_t index);
+    void insertSlot(size_t index, uint64_t key, int port, uint32_t lastSeen);
+    void scheduleNode(uint32_t node, uint32_t deadline);
+    uint32_t expireNodes(uint32_t node, uint32_t now, size_t limit);
+    bool evictOldest();
+
+    /**
+     * @struct PortLearning
+     * @brief Ограничения и счётчики обучения порта (своя строка кэша на порт)
+     *
+     * Поля меняются под мьютексом (кроме rejected), а читаются и без него:
+     * отказ по ограничениям порта не берёт мьютекс.
+     */
+    struct alignas(kCacheLine) PortLearning {
+        LearnLimits limits;                ///< Ограничения (задаются до запуска потоков)
+        std::atomic<uint32_t> entries{0};  ///< Адресов порта в таблице
+        std::atomic<uint32_t> window{0};   ///< Секунда, к которой относится learns
+        std::atomic<uint32_t> learns{0};   ///< Обучений за секунду window
+        std::atomic<uint64_t> rejected{0}; ///< Отказов в обучении
+    };
+
+    /**
+     * @brief Ограничения и счётчики порта (порты не меньше kMaxLearnPorts делят последнюю запись)
+     */
+    PortLearning& learning(int port) const {
+        return learning_[port >= 0 && size_t(port) < kMaxLearnPorts ? size_t(port) : kMaxLearnPorts];
+    }
+    static bool learnAllowed(const PortLearning& learning, uint32_t now);
+
+    std::unique_ptr<Slot[], SlotDeleter> slots_;  ///< Ячейки хэш-таблицы (выровнены по строке кэша)
+    size_t mask_ = 0;                             ///< Число ячеек минус 1 (число ячеек — степень двойки)
+    unsigned shift_ = 0;                          ///< Сдвиг мультипликативного хэша
+    size_t capacity_ = 0;                         ///< Максимальное число записей
+    std::atomic<size_t> size_{0};                 ///< Текущее число записей
+    std::atomic<uint64_t> learned_{0};            ///< Выучено адресов (меняется под мьютексом)
+    std::atomic<uint64_t> moved_{0};              ///< Смен порта (меняется под мьютексом)
+    std::atomic<uint64_t> aged_{0};               ///< Удалено устаревших (меняется под мьютексом)
+    std::atomic<uint64_t> evicted_{0};            ///< Вытеснено записей (меняется под мьютексом)
+    FullPolicy fullPolicy_;                       ///< Что делать с новым адресом в заполненной таблице
+    uint64_t hashKey_[2];                         ///< Секрет SipHash (случайный для процесса)
+    std::unique_ptr<PortLearning[]> learning_;    ///< Обучение портов (kMaxLearnPorts + 1 запись)
+    std::chrono::steady_clock::time_point epoch_; ///< Точка отсчёта времени записей (время жизни до создания)
+
+    // Колесо таймеров старения (под мьютексом писателей)
+    /// Пустая ссылка в списках колеса
+    static constexpr uint32_t kNil = UINT32_MAX;
+    std::unique_ptr<uint64_t[]> nodeKey_;   ///< Ключ записи для каждого узла колеса
+    std::unique_ptr<uint32_t[]> nodeNext_;  ///< Следующий узел в корзине или в списке свободных
+    uint32_t freeNodes_ = kNil;             ///< Голова списка свободных узлов
+    std::vector<uint32_t> wheel_;           ///< Головы списков корзин (по секунде на корзину)
+    uint32_t wheelMask_ = 0;                ///< Число корзин минус 1
+    uint32_t agedUpTo_ = 0;                 ///< Последняя обработанная секунда
+
+    /// Счётчик версий: нечётный, пока записи перемещаются при удалении
+    alignas(kCacheLine) std::atomic<uint32_t> seq_{0};
+    /// Счётчик изменений (добавление, смена порта, удаление); в одной строке кэша с seq_
+    std::atomic<uint64_t> generation_{0};
+
+    alignas(kCacheLine) mutable std::mutex mutex_; ///< Мьютекс писателей таблицы
+    int maxLifetimeSec_;                          ///< Максимальное время жизни записи в секундах
+
+    /**
+     * @struct StatsShard
+     * @brief Гистограмма задержек одной пары «поток, порт»
+     */
+    struct alignas(kCacheLine) StatsShard {
+        LatencyHistogram histogram; ///< Задержки обработки
+        std::atomic<int> port{-1};  ///< Порт, -1 — гистограмма свободна
+    };
+
+    StatsShard* statsShard(int port);
+
+    static inline std::atomic<uint64_t> nextId_{1}; ///< Номер следующей созданной таблицы
 
     // Статистические данные
-    std::vector<double> processingTimes_;     ///< Времена обработки пакетов
-    double maxProcessingTime_ = 0;            ///< Максимальное время обработки
-    std::atomic<uint64_t> totalPackets_{0};   ///< Счетчик обработанных пакетов
+    /// Номер таблицы в процессе: ключ кэша гистограмм потока. Адрес удалённой таблицы
+    /// может достаться новой, а номер — нет
+    const uint64_t id_ = nextId_.fetch_add(1, std::memory_order_relaxed);
+    std::unique_ptr<StatsShard[]> statsShards_;  ///< Гистограммы пар «поток, порт»
+    std::atomic<size_t> statsShardCount_{0};     ///< Число занятых гистограмм
+    std::unique_ptr<StatsShard> sharedShard_;    ///< Общая гистограмма при нехватке kMaxStatsShards
+    mutable std::mutex statsMutex_;              ///< Защищает предыдущий снимок для расчёта скорости
+    mutable std::map<int, uint64_t> prevPackets_; ///< Число пакетов по портам при прошлом выводе
+    mutable std::chrono::steady_clock::time_point prevStatsTime_; ///< Время прошлого вывода
 };
 
-#endif
\ No newline at end of file
+#endif
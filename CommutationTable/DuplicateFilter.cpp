@@ -0,0 +1,45 @@
+#include "DuplicateFilter.h"
+#include <random>
+
+namespace {
+
+    /// Длина MAC-адресов назначения и источника в начале кадра
+    constexpr int kMacHeader = 12;
+    /// Сколько байт кадра (без тега) входит в хэш: заголовки L2–L4 с идентификатором IP
+    constexpr int kHashedBytes = 64;
+
+} // namespace
+
+DuplicateFilter::DuplicateFilter(size_t slots, uint32_t windowUs)
+    : window_(std::max<uint32_t>(1, uint32_t((uint64_t(windowUs) * 1000 + (1u << kTimeShift) - 1) >> kTimeShift))) {
+    size_t slotCount = 16;
+    while (slotCount < slots) {
+        slotCount <<= 1;
+    }
+    slots_.reset(new std::atomic<uint64_t>[slotCount]);
+    for (size_t i = 0; i < slotCount; ++i) {
+        slots_[i].store(0, std::memory_order_relaxed);
+    }
+    mask_ = slotCount - 1;
+
+    // Без секрета можно было бы подобрать кадр с отпечатком чужого и отбросить его
+    std::random_device random;
+    seed_ = (uint64_t(random()) << 32) | random();
+}
+
+uint64_t DuplicateFilter::frameHash(const u_char* frame, int length, bool tagged) const {
+    // Кадр без тега собирается в буфер фиксированной длины, хвост заполнен нулями
+    uint64_t words[kHashedBytes / 8] = {};
+    auto* bytes = reinterpret_cast<u_char*>(words);
+    const int offset = kMacHeader + (tagged ? 4 : 0);
+    memcpy(bytes, frame, kMacHeader);
+    memcpy(bytes + kMacHeader, frame + offset, size_t(std::clamp(length - offset, 0, kHashedBytes - kMacHeader)));
+
+    uint64_t hash = seed_ ^ (uint64_t(length - offset + kMacHeader) * 0x9E3779B97F4A7C15ull);
+    for (uint64_t word : words) {
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    return hash ^ (hash >> 29);
+}
@@ -0,0 +1,108 @@
+#ifndef DUPLICATE_FILTER_H
+#define DUPLICATE_FILTER_H
+
+#include "../Headers.h"
+
+/**
+ * @class DuplicateFilter
+ * @brief Фильтр кадров, которые коммутатор сам недавно отправил (эхо отправки и петли L2)
+ *
+ * Для каждого отправленного кадра запоминается отпечаток его начала (MAC-адреса
+ * и первые байты после тега VLAN) вместе со временем, портом приёма и портом
+ * отправки. Кадр, принятый в течение окна с тем же отпечатком, — копия
+ * отправленного: на порт отправки он вернулся эхом (драйвер отдал захвату
+ * исходящий кадр), на другой порт — через петлю в сети. Такие кадры не
+ * обучают таблицу и не рассылаются повторно. Копия кадра, разосланного в несколько
+ * портов, считается петлёй на любом порту, в том числе на порту приёма исходного:
+ * петля через сегмент отправителя возвращает кадр именно туда. Индивидуальный
+ * кадр, снова принятый на порту приёма исходного, копией не считается: это
+ * повтор отправителя.
+ *
+ * Таблица прямого отображения из атомарных 64-битных ячеек без блокировок:
+ * [отпечаток 24 бита | время 24 бита | порт приёма 8 бит | порт отправки 8 бит].
+ * Гонка писателей лишь теряет одну запись, и её копия будет обработана как новый кадр.
+ */
+class DuplicateFilter {
+public:
+    /// Номер порта в ячейке: кадр отправлен в несколько портов или создан коммутатором
+    static constexpr uint32_t kNoPort = 0xFF;
+    /// Единица времени ячейки — 2^14 нс (около 16 мкс); 24 бита покрывают около 275 с
+    static constexpr unsigned kTimeShift = 14;
+
+    /**
+     * @enum Verdict
+     * @brief Результат проверки принятого кадра
+     */
+    enum class Verdict {
+        New,    ///< Кадр не отправлялся коммутатором в пределах окна
+        Echo,   ///< Вернулся на порт, в который был отправлен
+        Loop,   ///< Вернулся на другой порт
+    };
+
+    /**
+     * @brief Создаёт пустой фильтр
+     * @param slots Число ячеек (округляется вверх до степени двойки)
+     * @param windowUs Сколько микросекунд помнить отправленный кадр
+     */
+    DuplicateFilter(size_t slots, uint32_t windowUs);
+
+    DuplicateFilter(const DuplicateFilter&) = delete;
+    DuplicateFilter& operator=(const DuplicateFilter&) = delete;
+
+    /**
+     * @brief Хэш кадра без тега VLAN: MAC-адреса, до 52 байт после тега и длина
+     * @param frame Кадр Ethernet
+     * @param length Длина кадра
+     * @param tagged Есть ли у кадра тег 802.1Q (он не входит в хэш: тег меняется при отправке)
+     */
+    uint64_t frameHash(const u_char* frame, int length, bool tagged) const;
+
+    /**
+     * @brief Проверяет, не копия ли принятый кадр недавно отправленного
+     * @param hash frameHash() кадра
+     * @param port Порт приёма
+     * @param nowNs Текущее время, нс
+     */
+    Verdict check(uint64_t hash, int port, uint64_t nowNs) const {
+        uint64_t word = slots_[hash & mask_].load(std::memory_order_relaxed);
+        if (word == 0 || (word >> 40) != fingerprint(hash) ||
+            ((timeUnits(nowNs) - uint32_t(word >> 16)) & 0xFFFFFF) > window_) {
+            return Verdict::New;
+        }
+        uint32_t ingress = uint32_t(word >> 8) & 0xFF;
+        uint32_t egress = uint32_t(word) & 0xFF;
+        if (egress == kNoPort) {
+            return Verdict::Loop;
+        }
+        if (ingress == portByte(port)) {
+            return Verdict::New;
+        }
+        return egress == portByte(port) ? Verdict::Echo : Verdict::Loop;
+    }
+
+    /**
+     * @brief Запоминает отправленный кадр
+     * @param hash frameHash() кадра в том виде, в каком он отправлен
+     * @param ingressPort Порт, на котором кадр был принят, -1 — кадр создан коммутатором
+     * @param egressPort Порт отправки, -1 — кадр отправлен в несколько портов
+     * @param nowNs Текущее время, нс
+     */
+    void recordSent(uint64_t hash, int ingressPort, int egressPort, uint64_t nowNs) {
+        uint64_t word = (uint64_t(fingerprint(hash)) << 40) | (uint64_t(timeUnits(nowNs)) << 16) |
+                        (uint64_t(portByte(ingressPort)) << 8) | portByte(egressPort);
+        slots_[hash & mask_].store(word, std::memory_order_relaxed);
+    }
+
+private:
+    static uint32_t fingerprint(uint64_t hash) { return uint32_t(hash >> 40); }
+    static uint32_t timeUnits(uint64_t nowNs) { return uint32_t(nowNs >> kTimeShift) & 0xFFFFFF; }
+    /// Номер порта в ячейке (порты с номером от 254 делят один номер, -1 — kNoPort)
+    static uint32_t portByte(int port) { return port < 0 ? kNoPort : uint32_t(std::min(port, int(kNoPort) - 1)); }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> slots_; ///< Ячейки, 0 — пустая
+    size_t mask_ = 0;                                ///< Число ячеек минус 1
+    uint32_t window_;                                ///< Окно в единицах времени ячейки
+    uint64_t seed_;                                  ///< Случайное начальное значение хэша
+};
+
+#endif // DUPLICATE_FILTER_H
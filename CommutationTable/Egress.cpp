@@ -0,0 +1,286 @@
+#include "Egress.h"
+
+DropPolicy parseDropPolicy(const std::string& str) {
+    if (str == "tail") return DropPolicy::Tail;
+    if (str == "head") return DropPolicy::Head;
+    throw std::invalid_argument("Invalid drop policy: " + str);
+}
+
+// ============ TxQueue ============
+
+TxQueue::TxQueue(size_t depth, size_t frameSize) : frameSize_(frameSize) {
+    size_t capacity = 2;
+    while (capacity < depth) {
+        capacity <<= 1;
+    }
+    mask_ = capacity - 1;
+    stride_ = (sizeof(SlotHeader) + frameSize + 63) & ~size_t(63);
+
+    storage_.reset(new (std::align_val_t(64)) uint8_t[capacity * stride_]);
+    for (size_t i = 0; i < capacity; ++i) {
+        SlotHeader* header = new (storage_.get() + i * stride_) SlotHeader;
+        header->sequence.store(i, std::memory_order_relaxed);
+        header->length = 0;
+        header->external = nullptr;
+    }
+}
+
+TxQueue::~TxQueue() {
+    // release() обнуляет указатель, поэтому ненулевой есть только у кадров, оставшихся в очереди
+    for (size_t i = 0; i <= mask_; ++i) {
+        delete[] slot(i)->external;
+    }
+}
+
+bool TxQueue::tryPush(const u_char* data, uint32_t length, u_char* external) {
+    size_t position = enqueuePos_.load(std::memory_order_relaxed);
+    SlotHeader* header;
+    for (;;) {
+        header = slot(position);
+        size_t sequence = header->sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(position);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Очередь заполнена
+        } else {
+            position = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (external) {
+        memcpy(external, data, length);
+    } else {
+        memcpy(slotData(header), data, length);
+    }
+    header->external = external;
+    header->length = length;
+    header->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool TxQueue::push(const u_char* data, uint32_t length, DropPolicy policy) {
+    // Длинный кадр — в отдельный буфер; выделяем его до захвата ячейки, чтобы
+    // не держать захваченную ячейку, если памяти нет
+    u_char* external = nullptr;
+    if (length > frameSize_) {
+        external = new (std::nothrow) u_char[length];
+        if (!external) {
+            oversize.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    bool pushed = tryPush(data, length, external);
+    if (!pushed && policy == DropPolicy::Head) {
+        // Отбрасывание старого кадра освобождает ячейку записи, только если она ещё
+        // не забрана потоком отправки (иначе место появится лишь после sendmmsg)
+        size_t enqueued = enqueuePos_.load(std::memory_order_relaxed);
+        size_t dequeued = dequeuePos_.load(std::memory_order_relaxed);
+        Claimed oldest;
+        if (dequeued + mask_ + 1 <= enqueued && claim(&oldest, 1) == 1) {
+            release(&oldest, 1);
+            headDrops.fetch_add(1, std::memory_order_relaxed);
+            pushed = tryPush(data, length, external);
+        }
+    }
+    if (!pushed) {
+        delete[] external;
+        tailDrops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Будим поток отправки, только если он заснул (см. waitForFrames)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        wakeUp();
+    }
+    return true;
+}
+
+size_t TxQueue::claim(Claimed* out, size_t max) {
+    size_t count = 0;
+    size_t position = dequeuePos_.load(std::memory_order_relaxed);
+    while (count < max) {
+        SlotHeader* header = slot(position);
+        size_t sequence = header->sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(position + 1);
+        if (diff == 0) {
+            if (dequeuePos_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                out[count++] = {header->external ? header->external : slotData(header), header->length, position};
+                ++position;
+            }
+        } else if (diff < 0) {
+            break; // Очередь пуста
+        } else {
+            position = dequeuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    return count;
+}
+
+void TxQueue::release(const Claimed* claimed, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        SlotHeader* header = slot(claimed[i].position);
+        delete[] header->external;
+        header->external = nullptr;
+        header->sequence.store(claimed[i].position + mask_ + 1, std::memory_order_release);
+    }
+}
+
+bool TxQueue::empty() const {
+    size_t position = dequeuePos_.load(std::memory_order_relaxed);
+    return slot(position)->sequence.load(std::memory_order_relaxed) != position + 1;
+}
+
+void TxQueue::waitForFrames(const std::atomic<bool>& running) {
+    for (int spin = 0; spin < 64; ++spin) {
+        if (!empty()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    // Пара «sleeping_ / sequence» с полными барьерами с обеих сторон гарантирует,
+    // что либо поток увидит новый кадр, либо писатель увидит sleeping_ и разбудит его
+    uint32_t epoch = wakeEpoch_.load(std::memory_order_acquire);
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (empty() && running.load(std::memory_order_relaxed)) {
+        wakeEpoch_.wait(epoch, std::memory_order_acquire);
+    }
+    sleeping_.store(false, std::memory_order_relaxed);
+}
+
+void TxQueue::wakeUp() {
+    wakeEpoch_.fetch_add(1, std::memory_order_release);
+    wakeEpoch_.notify_one();
+}
+
+size_t TxQueue::depth() const {
+    size_t enqueued = enqueuePos_.load(std::memory_order_relaxed);
+    size_t dequeued = dequeuePos_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+// ============ Egress ============
+
+Egress::Egress(const std::vector<SwitchPort>& ports, const EgressConfig& config)
+    : ports_(ports), config_(config) {
+    config_.batchSize = std::max<size_t>(config_.batchSize, 1);
+    for (size_t i = 0; i < ports.size(); ++i) {
+        queues_.push_back(std::make_unique<TxQueue>(config_.queueDepth, config_.frameSize));
+        stats_.push_back(std::make_unique<EgressStats>());
+    }
+    flushClaimed_.resize(config_.batchSize);
+    flushFrames_.resize(config_.batchSize);
+}
+
+Egress::~Egress() {
+    stop();
+}
+
+void Egress::start() {
+    running_ = true;
+    for (size_t port = 0; port < queues_.size(); ++port) {
+        threads_.emplace_back(&Egress::transmitThread, this, port);
+    }
+}
+
+void Egress::stop() {
+    running_ = false;
+    for (auto& queue : queues_) {
+        queue->wakeUp();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+size_t Egress::transmitBatch(size_t port, std::vector<TxQueue::Claimed>& claimed,
+                             std::vector<IoPort::TxFrame>& frames) {
+    TxQueue& queue = *queues_[port];
+    size_t count = queue.claim(claimed.data(), claimed.size());
+    if (count == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        frames[i] = {claimed[i].data, claimed[i].length};
+    }
+    size_t sent = ports_[port].io[0]->sendBurst(frames.data(), count);
+    queue.release(claimed.data(), count);
+
+    EgressStats& stats = *stats_[port];
+    stats.frames.store(stats.frames.load(std::memory_order_relaxed) + sent, std::memory_order_relaxed);
+    stats.batches.store(stats.batches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (sent < count) {
+        stats.errors.store(stats.errors.load(std::memory_order_relaxed) + count - sent, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void Egress::transmitThread(size_t port) {
+    TxQueue& queue = *queues_[port];
+    std::vector<TxQueue::Claimed> claimed(config_.batchSize);
+    std::vector<IoPort::TxFrame> frames(config_.batchSize);
+
+    for (;;) {
+        if (transmitBatch(port, claimed, frames) == 0) {
+            if (!running_) {
+                break;
+            }
+            queue.waitForFrames(running_);
+        }
+    }
+}
+
+size_t Egress::flush() {
+    size_t total = 0;
+    for (size_t port = 0; port < queues_.size(); ++port) {
+        while (size_t count = transmitBatch(port, flushClaimed_, flushFrames_)) {
+            total += count;
+        }
+    }
+    return total;
+}
+
+EgressPortStats Egress::portStats(size_t port) const {
+    const TxQueue& queue = *queues_[port];
+    const EgressStats& stats = *stats_[port];
+    EgressPortStats s;
+    s.frames = stats.frames.load(std::memory_order_relaxed);
+    s.batches = stats.batches.load(std::memory_order_relaxed);
+    s.errors = stats.errors.load(std::memory_order_relaxed);
+    s.tailDrops = queue.tailDrops.load(std::memory_order_relaxed);
+    s.headDrops = queue.headDrops.load(std::memory_order_relaxed);
+    s.oversize = queue.oversize.load(std::memory_order_relaxed);
+    s.depth = queue.depth();
+    return s;
+}
+
+void Egress::printStats() const {
+    std::cout << "\n=== Egress ===" << std::endl
+              << std::left << std::setw(12) << "Port"
+              << std::right << std::setw(12) << "Sent" << std::setw(10) << "Avg batch"
+              << std::setw(8) << "Depth" << std::setw(12) << "Tail drops"
+              << std::setw(12) << "Head drops" << std::setw(10) << "Oversize"
+              << std::setw(10) << "Errors" << std::endl;
+    for (size_t port = 0; port < queues_.size(); ++port) {
+        EgressPortStats stats = portStats(port);
+        std::cout << std::left << std::setw(12) << ports_[port].name
+                  << std::right << std::setw(12) << stats.frames
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(10) << (stats.batches ? double(stats.frames) / double(stats.batches) : 0.0)
+                  << std::defaultfloat
+                  << std::setw(8) << stats.depth
+                  << std::setw(12) << stats.tailDrops
+                  << std::setw(12) << stats.headDrops
+                  << std::setw(10) << stats.oversize
+                  << std::setw(10) << stats.errors << std::endl;
+    }
+    std::cout << "==============" << std::endl;
+}
@@ -0,0 +1,258 @@
+#ifndef EGRESS_H
+#define EGRESS_H
+
+#include "../Headers.h"
+#include "SwitchPort.h"
+
+/**
+ * @enum DropPolicy
+ * @brief Что отбрасывать, когда очередь отправки порта заполнена
+ */
+enum class DropPolicy {
+    Tail, ///< Отбросить новый кадр
+    Head  ///< Отбросить самый старый кадр очереди и поставить новый
+};
+
+/**
+ * @brief Преобразует строку "tail" или "head" в DropPolicy
+ * @throws std::invalid_argument Если строка не соответствует ни одной политике
+ */
+DropPolicy parseDropPolicy(const std::string& str);
+
+/**
+ * @struct EgressConfig
+ * @brief Параметры отправки (egress_batch_size, tx_queue_* в switch.cfg)
+ */
+struct EgressConfig {
+    size_t batchSize = 32;                ///< Максимальное число кадров в одном sendmmsg
+    size_t queueDepth = 1024;             ///< Ёмкость очереди порта, кадров (округляется до степени двойки)
+    size_t frameSize = 9216;              ///< Длина кадра, хранимого в ячейке очереди, байт
+    DropPolicy dropPolicy = DropPolicy::Tail; ///< Политика при заполнении очереди
+};
+
+/**
+ * @class TxQueue
+ * @brief Ограниченная очередь кадров без блокировок (много писателей, один отправляющий поток)
+ *
+ * Кольцо ячеек с порядковыми номерами (схема Д. Вьюкова). Кадры копируются прямо
+ * в ячейки; поток отправки забирает ячейки, отправляет кадры из них без копирования
+ * и только после этого возвращает ячейки писателям. При политике DropPolicy::Head
+ * писатель сам забирает и отбрасывает самый старый кадр.
+ *
+ * Кадр длиннее frameSize не отбрасывается: он копируется в отдельно выделенный
+ * буфер, а ячейка хранит указатель на него. Длина захваченного кадра ограничена
+ * только pcap_snaplen или блоком кольца, а ячейки такой длины заняли бы слишком
+ * много памяти, поэтому ячейка рассчитана на обычные и jumbo-кадры.
+ */
+class TxQueue {
+public:
+    /**
+     * @struct Claimed
+     * @brief Ячейка, забранная из очереди для отправки
+     */
+    struct Claimed {
+        const u_char* data; ///< Данные кадра
+        uint32_t length;    ///< Длина кадра
+        size_t position;    ///< Позиция в кольце (нужна для release)
+    };
+
+    /**
+     * @brief Создаёт очередь
+     * @param depth Ёмкость, кадров (округляется вверх до степени двойки)
+     * @param frameSize Длина кадра, хранимого в ячейке, байт (длинные кадры хранятся вне очереди)
+     */
+    TxQueue(size_t depth, size_t frameSize);
+
+    /**
+     * @brief Освобождает буферы длинных кадров, оставшихся в очереди
+     */
+    ~TxQueue();
+
+    TxQueue(const TxQueue&) = delete;
+    TxQueue& operator=(const TxQueue&) = delete;
+
+    /**
+     * @brief Копирует кадр в очередь
+     * @param data Данные кадра
+     * @param length Длина кадра
+     * @param policy Политика при заполнении очереди
+     * @return true, если кадр поставлен в очередь
+     */
+    bool push(const u_char* data, uint32_t length, DropPolicy policy);
+
+    /**
+     * @brief Забирает до max самых старых кадров
+     * @return Число забранных кадров
+     * @note Забранные ячейки нужно вернуть через release()
+     */
+    size_t claim(Claimed* out, size_t max);
+
+    /**
+     * @brief Возвращает забранные ячейки писателям
+     */
+    void release(const Claimed* claimed, size_t count);
+
+    /**
+     * @brief Ждёт появления кадров (сначала активно, затем засыпает)
+     * @param running Флаг работы; при его сбросе нужно вызвать wakeUp()
+     */
+    void waitForFrames(const std::atomic<bool>& running);
+
+    /**
+     * @brief Будит поток, ожидающий в waitForFrames()
+     */
+    void wakeUp();
+
+    /**
+     * @brief Примерное число кадров в очереди
+     */
+    size_t depth() const;
+
+    std::atomic<uint64_t> tailDrops{0};   ///< Отброшено новых кадров
+    std::atomic<uint64_t> headDrops{0};   ///< Отброшено старых кадров
+    std::atomic<uint64_t> oversize{0};    ///< Отброшено кадров длиннее frameSize: не хватило памяти для буфера
+
+private:
+    /**
+     * @struct SlotHeader
+     * @brief Заголовок ячейки, за ним следуют данные кадра
+     */
+    struct SlotHeader {
+        std::atomic<size_t> sequence; ///< Порядковый номер ячейки
+        uint32_t length;              ///< Длина кадра
+        u_char* external;             ///< Буфер кадра длиннее frameSize, nullptr — кадр в ячейке
+    };
+
+    SlotHeader* slot(size_t position) const {
+        return reinterpret_cast<SlotHeader*>(storage_.get() + (position & mask_) * stride_);
+    }
+    static u_char* slotData(SlotHeader* header) {
+        return reinterpret_cast<u_char*>(header) + sizeof(SlotHeader);
+    }
+    bool tryPush(const u_char* data, uint32_t length, u_char* external);
+    bool empty() const;
+
+    struct StorageDeleter {
+        void operator()(uint8_t* p) const { ::operator delete[](p, std::align_val_t(64)); }
+    };
+
+    std::unique_ptr<uint8_t[], StorageDeleter> storage_; ///< Ячейки очереди
+    size_t mask_ = 0;                                    ///< Ёмкость минус 1
+    size_t stride_ = 0;                                  ///< Размер ячейки (кратен 64)
+    size_t frameSize_ = 0;                               ///< Длина кадра, хранимого в ячейке
+
+    alignas(64) std::atomic<size_t> enqueuePos_{0};      ///< Позиция записи
+    alignas(64) std::atomic<size_t> dequeuePos_{0};      ///< Позиция чтения
+    alignas(64) std::atomic<bool> sleeping_{false};      ///< Поток отправки спит в waitForFrames()
+    std::atomic<uint32_t> wakeEpoch_{0};                 ///< Счётчик пробуждений для atomic::wait
+};
+
+/**
+ * @struct EgressStats
+ * @brief Счётчики отправки одного порта
+ */
+struct EgressStats {
+    std::atomic<uint64_t> frames{0};   ///< Отправлено кадров
+    std::atomic<uint64_t> batches{0};  ///< Выполнено пакетных отправок
+    std::atomic<uint64_t> errors{0};   ///< Кадров, которые не удалось отправить
+};
+
+/**
+ * @struct EgressPortStats
+ * @brief Снимок счётчиков отправки и очереди одного порта
+ */
+struct EgressPortStats {
+    uint64_t frames = 0;    ///< Отправлено кадров
+    uint64_t batches = 0;   ///< Выполнено пакетных отправок
+    uint64_t errors = 0;    ///< Кадров, которые не удалось отправить
+    uint64_t tailDrops = 0; ///< Отброшено новых кадров
+    uint64_t headDrops = 0; ///< Отброшено старых кадров
+    uint64_t oversize = 0;  ///< Отброшено длинных кадров: не хватило памяти для буфера
+    size_t depth = 0;       ///< Кадров в очереди
+};
+
+/**
+ * @class Egress
+ * @brief Отправка кадров: очередь и отдельный поток отправки на каждый порт
+ *
+ * Потоки приёма только копируют кадры в очереди портов и не ждут медленный
+ * интерфейс. Поток отправки порта — единственный, кто пишет в его интерфейс:
+ * он забирает все накопившиеся кадры (до batchSize) и отправляет их одним
+ * IoPort::sendBurst() (для настоящих интерфейсов — одним sendmmsg).
+ *
+ * Без потоков отправки (start() не вызван) очереди опустошает flush()
+ * в вызывающем потоке — так работают однопоточные бенчмарки.
+ */
+class Egress {
+public:
+    /**
+     * @brief Создаёт очереди для всех портов
+     * @param ports Порты коммутатора
+     * @param config Параметры отправки
+     */
+    Egress(const std::vector<SwitchPort>& ports, const EgressConfig& config);
+
+    /**
+     * @brief Останавливает потоки отправки
+     */
+    ~Egress();
+
+    /**
+     * @brief Запускает по потоку отправки на порт
+     */
+    void start();
+
+    /**
+     * @brief Отправляет оставшиеся в очередях кадры и останавливает потоки
+     */
+    void stop();
+
+    /**
+     * @brief Отправляет все кадры из очередей в вызывающем потоке
+     * @return Число кадров, забранных из очередей (включая неотправленные)
+     * @note Только когда потоки отправки не запущены
+     */
+    size_t flush();
+
+    /**
+     * @brief Ставит кадр в очередь порта
+     * @param port Порт назначения
+     * @param data Данные кадра (копируются)
+     * @param length Длина кадра
+     * @return true, если кадр поставлен в очередь
+     */
+    bool send(int port, const u_char* data, uint32_t length) {
+        return queues_[port]->push(data, length, config_.dropPolicy);
+    }
+
+    /**
+     * @brief Число портов
+     */
+    size_t portCount() const { return queues_.size(); }
+
+    /**
+     * @brief Возвращает снимок счётчиков порта
+     */
+    EgressPortStats portStats(size_t port) const;
+
+    /**
+     * @brief Выводит по портам глубину очереди, отбрасывания и средний размер пачки
+     */
+    void printStats() const;
+
+private:
+    void transmitThread(size_t port);
+    size_t transmitBatch(size_t port, std::vector<TxQueue::Claimed>& claimed,
+                         std::vector<IoPort::TxFrame>& frames);
+
+    const std::vector<SwitchPort>& ports_;                ///< Порты коммутатора
+    EgressConfig config_;                                 ///< Параметры отправки
+    std::vector<std::unique_ptr<TxQueue>> queues_;        ///< Очереди портов
+    std::vector<std::unique_ptr<EgressStats>> stats_;     ///< Счётчики портов
+    std::vector<std::thread> threads_;                    ///< Потоки отправки
+    std::atomic<bool> running_{false};                    ///< Флаг работы потоков отправки
+    std::vector<TxQueue::Claimed> flushClaimed_;          ///< Буферы пачки для flush()
+    std::vector<IoPort::TxFrame> flushFrames_;
+};
+
+#endif // EGRESS_H
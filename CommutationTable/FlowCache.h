@@ -0,0 +1,148 @@
+#ifndef FLOW_CACHE_H
+#define FLOW_CACHE_H
+
+#include "../Headers.h"
+#include "RuleTable.h"
+#include "NetworkUtils/NetworkUtils.h"
+
+/**
+ * @class FlowCache
+ * @brief Кэш решений о пересылке одного потока захвата (прямое отображение)
+ *
+ * Ключ — порт приёма, VLAN, MAC-адреса источника и назначения и EtherType. Если в
+ * таблице правил есть правила, решение по ним зависит от полей IPv4 и L4,
+ * поэтому для кадров IPv4 к ключу добавляется FlowKey. В записи хранятся
+ * порт назначения (-1 — рассылка во все порты), действие правила и индекс
+ * записи источника в таблице коммутации для продления её жизни без поиска.
+ *
+ * Запись верна, пока не изменился CommutationTable::generation(): при попадании
+ * кадр не обращается к общей таблице, кроме записи времени активности источника.
+ * Кэшем пользуется один поток, поэтому счётчики попаданий и промахов обновляются
+ * без атомарных сложений, а читать их можно из любого потока. Запись занимает
+ * одну строку кэша процессора.
+ */
+class FlowCache {
+public:
+    /**
+     * @struct Entry
+     * @brief Запись кэша
+     */
+    struct alignas(64) Entry {
+        uint64_t generation = UINT64_MAX;   ///< CommutationTable::generation() при заполнении
+        uint64_t l2a = 0;                   ///< MAC источника и порт приёма
+        uint64_t l2b = 0;                   ///< MAC назначения и EtherType
+        uint64_t l3a = 0;                   ///< Адреса IPv4 (если ключ с FlowKey)
+        uint64_t l3b = 0;                   ///< Протокол, тип ICMP, порты L4 и признак FlowKey
+        const RuleAction *action = nullptr; ///< Действие правила, nullptr — нет
+        size_t srcEntry = 0;                ///< Индекс записи источника (из CommutationTable::updateEntry)
+        int egressPort = -1;                ///< Порт назначения, -1 — рассылка во все порты
+        uint32_t vlan = 0;                  ///< VLAN кадра
+    };
+
+    /**
+     * @struct Key
+     * @brief Упакованный ключ кадра
+     */
+    struct Key {
+        uint64_t l2a, l2b, l3a, l3b;
+        uint32_t vlan;
+    };
+
+    /**
+     * @brief Создаёт кэш
+     * @param size Число записей (округляется вверх до степени двойки)
+     */
+    explicit FlowCache(size_t size) {
+        size_t capacity = 1;
+        while (capacity < size) {
+            capacity <<= 1;
+        }
+        entries_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+
+    FlowCache(const FlowCache &) = delete;
+    FlowCache &operator=(const FlowCache &) = delete;
+
+    /**
+     * @brief Упаковывает ключ кадра
+     * @param port Порт приёма
+     * @param eth Заголовок Ethernet
+     * @param flow Поля IPv4 для правил или nullptr
+     * @param vlan VLAN кадра
+     */
+    static Key makeKey(int port, const struct ether_header *eth, const FlowKey *flow, uint16_t vlan) {
+        Key key{};
+        key.vlan = vlan;
+        key.l2a = utils::macToU64(eth->ether_shost) | (uint64_t(uint16_t(port)) << 48);
+        key.l2b = utils::macToU64(eth->ether_dhost) | (uint64_t(eth->ether_type) << 48);
+        if (flow) {
+            key.l3a = (uint64_t(flow->src) << 32) | flow->dst;
+            key.l3b = (uint64_t(flow->proto) << 48) | (uint64_t(flow->hasL4) << 40) |
+                      (uint64_t(flow->icmpType) << 32) | (uint64_t(flow->srcPort) << 16) | flow->dstPort |
+                      kWithFlow;
+        }
+        return key;
+    }
+
+    /**
+     * @brief Ищет действующую запись
+     * @param key Ключ кадра
+     * @param generation Текущее CommutationTable::generation()
+     * @return Запись или nullptr при промахе
+     */
+    const Entry *find(const Key &key, uint64_t generation) {
+        const Entry &entry = entries_[slot(key)];
+        if (entry.generation == generation && entry.l2a == key.l2a && entry.l2b == key.l2b &&
+            entry.l3a == key.l3a && entry.l3b == key.l3b && entry.vlan == key.vlan) {
+            hits_.store(hits_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return &entry;
+        }
+        misses_.store(misses_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    /**
+     * @brief Запоминает решение (вытесняя запись с тем же индексом)
+     * @param generation CommutationTable::generation(), прочитанный до обучения и поиска в таблице
+     */
+    void insert(const Key &key, uint64_t generation, size_t srcEntry, int egressPort, const RuleAction *action) {
+        Entry &entry = entries_[slot(key)];
+        entry.generation = generation;
+        entry.l2a = key.l2a;
+        entry.l2b = key.l2b;
+        entry.l3a = key.l3a;
+        entry.l3b = key.l3b;
+        entry.vlan = key.vlan;
+        entry.srcEntry = srcEntry;
+        entry.egressPort = egressPort;
+        entry.action = action;
+    }
+
+    /**
+     * @brief Число попаданий
+     */
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Число промахов
+     */
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint64_t kWithFlow = 1ull << 63; ///< Признак ключа с FlowKey (в l3b)
+
+    size_t slot(const Key &key) const {
+        uint64_t h = (key.l2a ^ (uint64_t(key.vlan) << 52)) * 0x9E3779B97F4A7C15ull ^ key.l2b * 0xC2B2AE3D27D4EB4Full ^
+                     key.l3a * 0x165667B19E3779F9ull ^ key.l3b * 0x27D4EB2F165667C5ull;
+        h ^= h >> 31;
+        return size_t(h ^ (h >> 17)) & mask_;
+    }
+
+    std::vector<Entry> entries_;          ///< Записи
+    size_t mask_ = 0;                     ///< Число записей минус 1
+    std::atomic<uint64_t> hits_{0};       ///< Попадания
+    std::atomic<uint64_t> misses_{0};     ///< Промахи
+};
+
+#endif // FLOW_CACHE_H
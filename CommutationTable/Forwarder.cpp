@@ -0,0 +1,348 @@
+#include "Forwarder.h"
+
+namespace {
+
+    /// Длина MAC-адресов назначения и источника в начале кадра
+    constexpr int kMacHeader = 12;
+
+    /**
+     * @class VlanFrame
+     * @brief Кадр в виде с тегом 802.1Q и без: недостающий вид строится при первом запросе
+     *
+     * Построенные виды лежат в буферах потока, поэтому новый VlanFrame в том же
+     * потоке делает недействительными виды, полученные от прежнего.
+     */
+    class VlanFrame {
+    public:
+        VlanFrame(const u_char *data, int length, bool tagged, uint16_t vlan)
+            : data_(data), length_(length), tagged_(tagged), vlan_(vlan) {}
+
+        /**
+         * @brief Кадр с тегом VLAN кадра или без тега
+         * @param wantTagged Нужен ли тег
+         * @param length Длина возвращённого кадра
+         */
+        const u_char *get(bool wantTagged, int &length) {
+            if (wantTagged == tagged_ && (!tagged_ || (tci() & 0x0FFF) == vlan_)) {
+                length = length_;
+                return data_;
+            }
+            thread_local std::vector<u_char> buffers[2];
+            std::vector<u_char> &buffer = buffers[wantTagged];
+            int &built = built_[wantTagged];
+            if (built == 0) {
+                built = build(buffer, wantTagged);
+            }
+            length = built;
+            return buffer.data();
+        }
+
+    private:
+        uint16_t tci() const {
+            uint16_t value;
+            memcpy(&value, data_ + kMacHeader + 2, sizeof(value));
+            return ntohs(value);
+        }
+
+        int build(std::vector<u_char> &buffer, bool wantTagged) const {
+            const int payloadOffset = kMacHeader + (tagged_ ? 4 : 0);
+            const int payload = length_ - payloadOffset;
+            const int length = kMacHeader + (wantTagged ? 4 : 0) + payload;
+            if (buffer.size() < size_t(length)) {
+                buffer.resize(std::max(length, 65536));
+            }
+            u_char *out = buffer.data();
+            memcpy(out, data_, kMacHeader);
+            out += kMacHeader;
+            if (wantTagged) {
+                // Приоритет (PCP) переносится из исходного тега
+                uint16_t tag[2] = {htons(ETHERTYPE_VLAN), htons(uint16_t((tagged_ ? tci() & 0xF000 : 0) | vlan_))};
+                memcpy(out, tag, sizeof(tag));
+                out += sizeof(tag);
+            }
+            memcpy(out, data_ + payloadOffset, payload);
+            return length;
+        }
+
+        const u_char *data_;
+        int length_;
+        bool tagged_;
+        uint16_t vlan_;
+        int built_[2] = {0, 0}; ///< Длина построенного вида без тега и с тегом, 0 — не построен
+    };
+
+} // namespace
+
+void processPacket(const u_char *packet, int packetLength, int wireLength, bool writable, int port,
+                   CommutationTable &table, Egress &egress,
+                   const RuleTable &rules, IngressStats &ingress, FlowCache *cache,
+                   const ForwardingFeatures *features) {
+    static const ForwardingFeatures kNoFeatures;
+    const ForwardingFeatures &enabled = features ? *features : kNoFeatures;
+    StormControl *storm = enabled.storm;
+    GroupTable *groups = enabled.groups;
+    ArpCache *arp = enabled.arp;
+    const VlanTable *vlans = enabled.vlans;
+    const LagTable *lags = enabled.lags;
+    DuplicateFilter *duplicates = enabled.duplicates;
+
+    // Обрезанный кадр не пересылаем: вместо хвоста ушёл бы мусор или кадр другой длины
+    if (packetLength < wireLength || packetLength < int(sizeof(struct ether_header))) {
+        ingress.truncated.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const u_char *packet_to_send = packet; // По умолчанию отправляем исходный пакет
+
+    struct ether_header *eth_header = (struct ether_header *)packet;
+
+    // Пропускаем пакеты с одинаковыми MAC-адресами источника и назначения
+    if (memcmp(eth_header->ether_shost, eth_header->ether_dhost, 6) == 0) {
+        ingress.dropped.fetch_add(1, std::memory_order_relaxed);
+        auto end = std::chrono::steady_clock::now();
+        table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return;
+    }
+
+    // VLAN кадра: без таблицы VLAN все кадры в VLAN по умолчанию и уходят как приняты
+    uint16_t vlan = CommutationTable::kDefaultVlan;
+    bool tagged = false;
+    if (vlans && !vlans->classify(port, packet, packetLength, vlan, tagged)) {
+        ingress.dropped.fetch_add(1, std::memory_order_relaxed);
+        auto end = std::chrono::steady_clock::now();
+        table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return;
+    }
+    // Копия кадра, который коммутатор сам недавно отправил (эхо или петля), не обучает и не рассылается
+    uint64_t frameHash = 0;
+    uint64_t nowNs = 0;
+    if (duplicates) {
+        nowNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count());
+        frameHash = duplicates->frameHash(packet, packetLength, tagged);
+        DuplicateFilter::Verdict verdict = duplicates->check(frameHash, port, nowNs);
+        if (verdict != DuplicateFilter::Verdict::New) {
+            (verdict == DuplicateFilter::Verdict::Echo ? ingress.echoed : ingress.looped)
+                    .fetch_add(1, std::memory_order_relaxed);
+            auto end = std::chrono::steady_clock::now();
+            table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            return;
+        }
+    }
+
+    // Порт группы агрегирования обучается и участвует в IGMP snooping как логический порт группы
+    const int ingressPort = lags ? lags->logical(port) : port;
+    uint16_t etherType = eth_header->ether_type;
+    if (tagged) {
+        memcpy(&etherType, packet + sizeof(struct ether_header) + 2, sizeof(etherType));
+    }
+
+    // Привязки IPv4 -> MAC из ответов ARP (ответы обычно индивидуальные, поэтому до поиска в таблице)
+    if (arp && etherType == htons(ETHERTYPE_ARP)) {
+        int length;
+        const u_char *untagged = VlanFrame(packet, packetLength, tagged, vlan).get(false, length);
+        arp->learn(untagged, length, vlan);
+    }
+
+    // Правила: зеркалирование, отбрасывание и изменение кадра
+    FlowKey key;
+    const bool hasFlow = !rules.empty() && RuleTable::extractKey(packet, packetLength, key);
+    const RuleAction *action;
+    int dest_port;
+
+    // Решение для потока уже принято и таблица с тех пор не менялась: ни обучения, ни поиска
+    FlowCache::Key cacheKey;
+    const FlowCache::Entry *cached = nullptr;
+    if (cache) {
+        cacheKey = FlowCache::makeKey(port, eth_header, hasFlow ? &key : nullptr, vlan);
+        cached = cache->find(cacheKey, table.generation());
+    }
+    if (cached) {
+        if (cached->srcEntry != CommutationTable::kNoEntry) {
+            table.touchEntry(cached->srcEntry, start);
+        }
+        action = cached->action;
+        dest_port = cached->egressPort;
+    } else {
+        // Счётчик читается до обучения и поиска: удаление или вытеснение записи источника
+        // после чтения делает запись кэша устаревшей. Обучение нового адреса тоже меняет
+        // счётчик, поэтому новый поток попадает в кэш со второго кадра
+        uint64_t generation = table.generation();
+        size_t srcEntry = table.updateEntry(eth_header->ether_shost, ingressPort, vlan);
+        action = hasFlow ? rules.classify(key) : nullptr;
+        dest_port = table.getPortForMac(eth_header->ether_dhost, vlan);
+        // Отказ в обучении не кэшируется: иначе адрес не выучился бы и после снятия ограничения
+        if (cache && srcEntry != CommutationTable::kNoEntry) {
+            cache->insert(cacheKey, generation, srcEntry, dest_port, action);
+        }
+    }
+    if (action) {
+        // Зеркалируется кадр в том виде, в каком он принят
+        if (action->mirrorPort >= 0 && action->mirrorPort != port) {
+            egress.send(action->mirrorPort, packet, packetLength);
+        }
+        if (action->drop) {
+            ingress.dropped.fetch_add(1, std::memory_order_relaxed);
+            auto end = std::chrono::steady_clock::now();
+            table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            return;
+        }
+        if (action->rewrites()) {
+            u_char *modified_packet;
+            if (writable) {
+                // Кадр в кольце принадлежит нам до возврата блока ядру — меняем его на месте
+                modified_packet = const_cast<u_char *>(packet);
+            } else {
+                // Буфер libpcap менять нельзя: копируем кадр в буфер потока, выделяемый один раз
+                thread_local std::vector<u_char> scratch;
+                if (scratch.size() < size_t(packetLength)) {
+                    scratch.resize(std::max<size_t>(packetLength, 65536));
+                }
+                memcpy(scratch.data(), packet, packetLength);
+                modified_packet = scratch.data();
+            }
+            RuleTable::apply(*action, modified_packet, packetLength);
+            packet_to_send = modified_packet;
+            if (duplicates) {
+                frameHash = duplicates->frameHash(packet_to_send, packetLength, tagged);
+            }
+        }
+    }
+
+    // Отправляем только один пакет (либо исходный, либо модифицированный),
+    // в порт trunk — с тегом VLAN, в порт access и в native VLAN — без тега
+    VlanFrame frame(packet_to_send, packetLength, tagged, vlan);
+    auto sendTo = [&](size_t dest) {
+        if (!vlans) {
+            egress.send(dest, packet_to_send, packetLength);
+            return;
+        }
+        int length;
+        const u_char *data = frame.get(vlans->egressTagged(dest, vlan), length);
+        egress.send(dest, data, length);
+    };
+    // Канал группы агрегирования выбирается по хэшу потока: хэш считается, только если он нужен
+    uint32_t flowHash = 0;
+    bool hashed = false;
+    auto member = [&](int dest) {
+        if (!lags || !lags->isMember(dest)) {
+            return dest;
+        }
+        if (!hashed) {
+            int length;
+            const u_char *untagged = frame.get(false, length);
+            flowHash = lags->flowHash(untagged, length);
+            hashed = true;
+        }
+        return lags->select(dest, flowHash);
+    };
+    // Запись из снимка могла остаться от прежних настроек VLAN: порт вне VLAN кадра
+    // не получает его, кадр рассылается по VLAN как кадр с неизвестным адресом
+    if (vlans && dest_port >= 0 && dest_port < (int)egress.portCount() && !vlans->isMember(size_t(dest_port), vlan)) {
+        dest_port = -1;
+    }
+    if (dest_port != -1 && dest_port < (int)egress.portCount()) {
+        int dest = member(dest_port);
+        if (dest == -1) {
+            // Все каналы группы упали
+            ingress.dropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            if (duplicates) {
+                duplicates->recordSent(frameHash, port, dest, nowNs);
+            }
+            sendTo(size_t(dest));
+        }
+    } else {
+        StormClass cls = StormClass::Multicast;
+        if ((eth_header->ether_dhost[0] & 0x01) == 0) {
+            cls = StormClass::UnknownUnicast;
+        } else if (memcmp(eth_header->ether_dhost, "\xff\xff\xff\xff\xff\xff", 6) == 0) {
+            cls = StormClass::Broadcast;
+        }
+        // Запрос ARP об известном адресе: отвечаем сами в порт приёма вместо рассылки
+        if (arp && cls == StormClass::Broadcast && etherType == htons(ETHERTYPE_ARP)) {
+            int length;
+            const u_char *untagged = frame.get(false, length);
+            u_char reply[ArpCache::kReplyLength];
+            if (arp->answer(untagged, length, vlan, table, reply)) {
+                VlanFrame answer(reply, ArpCache::kReplyLength, false, vlan);
+                const u_char *data = answer.get(vlans && vlans->egressTagged(size_t(port), vlan), length);
+                if (duplicates) {
+                    duplicates->recordSent(duplicates->frameHash(reply, ArpCache::kReplyLength, false), -1, port,
+                                           nowNs);
+                }
+                egress.send(port, data, length);
+                auto end = std::chrono::steady_clock::now();
+                table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                return;
+            }
+        }
+        // Групповой кадр IPv4 уходит только в порты членов группы и опросчиков
+        uint64_t egressPorts = GroupTable::kFlood;
+        if (groups && cls == StormClass::Multicast) {
+            int length;
+            const u_char *untagged = frame.get(false, length);
+            egressPorts = groups->egressPorts(ingressPort, vlan, untagged, length);
+        }
+        // Незарегистрированная группа без рассылки (и без опросчиков): кадр никуда не уходит
+        if (egressPorts == 0) {
+            ingress.dropped.fetch_add(1, std::memory_order_relaxed);
+            auto end = std::chrono::steady_clock::now();
+            table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            return;
+        }
+        // Шторм не должен занять все порты отправки: сверх лимита класса кадр отбрасывается
+        if (storm && !storm->admit(port, cls, uint32_t(packetLength),
+                                   uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                           start.time_since_epoch()).count()))) {
+            ingress.stormDropped[size_t(cls)].fetch_add(1, std::memory_order_relaxed);
+            auto end = std::chrono::steady_clock::now();
+            table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            return;
+        }
+        // Счётчики только на редком пути: кадры, найденные в таблице, считаются как разность.
+        // Считаются лишь кадры, которые действительно уходят в порты
+        if (egressPorts != GroupTable::kFlood) {
+            ingress.multicastForwarded.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ingress.flooded.fetch_add(1, std::memory_order_relaxed);
+            if (cls == StormClass::UnknownUnicast) {
+                ingress.unknownUnicast.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (duplicates) {
+            duplicates->recordSent(frameHash, port, -1, nowNs);
+        }
+        // Рассылка не выходит за порты VLAN кадра; группа агрегирования получает
+        // одну копию (в канал потока) и не получает кадр, принятый на одном из её каналов
+        auto flood = [&](size_t i) {
+            bool selected = egressPorts == GroupTable::kFlood ||
+                            (i < GroupTable::kMaxPorts && (egressPorts >> i) & 1);
+            if (!selected || (lags && lags->logical(int(i)) != int(i)) || int(i) == ingressPort) {
+                return;
+            }
+            int dest = member(int(i));
+            if (dest != -1) {
+                sendTo(size_t(dest));
+            }
+        };
+        if (vlans) {
+            for (int i: vlans->members(vlan)) {
+                flood(size_t(i));
+            }
+        } else {
+            for (size_t i = 0; i < egress.portCount(); ++i) {
+                flood(i);
+            }
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    table.updateStats(port, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+void forwardFrame(void *user, u_char *data, uint32_t caplen, uint32_t len) {
+    auto *ctx = static_cast<CaptureContext *>(user);
+    processPacket(data, int(caplen), int(len), ctx->writable, ctx->port,
+                  *ctx->table, *ctx->egress, *ctx->rules, *ctx->ingress, ctx->cache, ctx->features);
+}
@@ -0,0 +1,76 @@
+#ifndef FORWARDER_H
+#define FORWARDER_H
+
+#include "../Headers.h"
+#include "CommutationTable.h"
+#include "Egress.h"
+#include "RuleTable.h"
+#include "SwitchPort.h"
+#include "FlowCache.h"
+#include "GroupTable.h"
+#include "ArpCache.h"
+#include "VlanTable.h"
+#include "LagTable.h"
+#include "DuplicateFilter.h"
+
+/**
+ * @struct ForwardingFeatures
+ * @brief Необязательные функции коммутатора, общие для всех потоков захвата
+ *
+ * Каждое поле может быть nullptr — функция выключена. Набор создаётся один раз
+ * при запуске; новая функция добавляется полем сюда, а не параметром processPacket.
+ */
+struct ForwardingFeatures {
+    StormControl *storm = nullptr;         ///< Ограничение рассылки, nullptr — без ограничения
+    GroupTable *groups = nullptr;          ///< Группы IGMP snooping, nullptr — групповые кадры во все порты
+    ArpCache *arp = nullptr;               ///< Кэш ARP, nullptr — запросы ARP во все порты
+    const VlanTable *vlans = nullptr;      ///< VLAN портов, nullptr — коммутатор не различает VLAN
+    const LagTable *lags = nullptr;        ///< Группы агрегирования каналов, nullptr — без групп
+    DuplicateFilter *duplicates = nullptr; ///< Фильтр эха и петель, nullptr — без фильтра
+};
+
+/**
+ * @struct CaptureContext
+ * @brief Данные потока захвата, передаваемые в обработчик кадров порта
+ */
+struct CaptureContext {
+    int port;                              ///< Номер порта
+    bool writable;                         ///< Можно ли изменять кадры порта на месте
+    CommutationTable *table;               ///< Таблица коммутации
+    Egress *egress;                        ///< Очереди отправки портов
+    const RuleTable *rules;                ///< Правила обработки кадров
+    IngressStats *ingress;                 ///< Счётчики приёма порта
+    FlowCache *cache;                      ///< Кэш решений потока захвата, nullptr — без кэша
+    const ForwardingFeatures *features;    ///< Необязательные функции, nullptr — все выключены
+};
+
+/**
+ * @brief Обрабатывает принятый кадр: обучение, правила и отправка
+ * @param packet Данные кадра
+ * @param packetLength Число захваченных байт кадра
+ * @param wireLength Длина кадра в сети (кадр длиннее snaplen захвачен не целиком)
+ * @param writable Можно ли изменять кадр на месте (IoPort::framesWritable())
+ * @param port Порт, на котором принят кадр
+ * @param table Таблица коммутации
+ * @param egress Очереди отправки портов
+ * @param rules Правила обработки кадров
+ * @param ingress Счётчики приёма порта
+ * @param cache Кэш решений вызывающего потока или nullptr
+ * @param features Необязательные функции или nullptr. Без таблицы VLAN все кадры
+ *                 в VLAN по умолчанию и теги не меняются
+ *
+ * Порт группы агрегирования обучается и ищется в таблицах как логический порт группы,
+ * а кадр в группу уходит в один её канал, выбранный по хэшу потока.
+ */
+void processPacket(const u_char *packet, int packetLength, int wireLength, bool writable, int port,
+                   CommutationTable &table, Egress &egress,
+                   const RuleTable &rules, IngressStats &ingress, FlowCache *cache = nullptr,
+                   const ForwardingFeatures *features = nullptr);
+
+/**
+ * @brief Обработчик кадров для IoPort::receiveBurst()
+ * @param user Указатель на CaptureContext порта
+ */
+void forwardFrame(void *user, u_char *data, uint32_t caplen, uint32_t len);
+
+#endif // FORWARDER_H
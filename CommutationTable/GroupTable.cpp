@@ -0,0 +1,326 @@
+#include "GroupTable.h"
+
+namespace {
+
+    // Типы сообщений IGMP
+    constexpr uint8_t kMembershipQuery = 0x11;
+    constexpr uint8_t kV1Report = 0x12;
+    constexpr uint8_t kV2Report = 0x16;
+    constexpr uint8_t kV2Leave = 0x17;
+    constexpr uint8_t kV3Report = 0x22;
+
+    // Типы записей отчёта IGMPv3 (RFC 3376, 4.2.12)
+    constexpr uint8_t kModeIsInclude = 1;
+    constexpr uint8_t kModeIsExclude = 2;
+    constexpr uint8_t kChangeToInclude = 3;
+    constexpr uint8_t kChangeToExclude = 4;
+    constexpr uint8_t kAllowNewSources = 5;
+
+    bool isMulticast(uint32_t address) {
+        return (address & 0xF0000000) == 0xE0000000;
+    }
+
+    /// 224.0.0.0/24: служебные группы (OSPF, IGMPv3 и т. п.) рассылаются всегда
+    bool isLinkLocalGroup(uint32_t address) {
+        return (address & 0xFFFFFF00) == 0xE0000000;
+    }
+
+    uint32_t readU32(const u_char* p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return ntohl(value);
+    }
+
+    uint16_t readU16(const u_char* p) {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return ntohs(value);
+    }
+
+} // namespace
+
+GroupTable::GroupTable(size_t ports, const Options& options)
+    : ports_(std::min(ports, kMaxPorts)),
+      options_(options),
+      epoch_(std::chrono::steady_clock::now()),
+      querierExpires_(ports_, 0) {
+    size_t slotCount = 16;
+    while (slotCount < options_.capacity * 2) {
+        slotCount <<= 1;
+    }
+    slots_.reset(new Slot[slotCount]);
+    mask_ = slotCount - 1;
+}
+
+uint32_t GroupTable::nowSec() const {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - epoch_).count());
+}
+
+size_t GroupTable::homeSlot(uint64_t key) const {
+    return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+}
+
+/**
+ * @brief Поиск маски группы без блокировки
+ *
+ * Как и в CommutationTable, читатель повторяет поиск, если таблица
+ * перестраивалась во время него.
+ */
+uint64_t GroupTable::lookup(uint64_t key) const {
+    for (;;) {
+        uint32_t version = seq_.load(std::memory_order_acquire);
+        if (version & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint64_t ports = 0;
+        size_t i = homeSlot(key);
+        for (size_t probes = 0; probes <= mask_; ++probes) {
+            uint64_t k = slots_[i].key.load(std::memory_order_relaxed);
+            if (k == 0) {
+                break;
+            }
+            if (k == key) {
+                ports = slots_[i].ports.load(std::memory_order_relaxed);
+                break;
+            }
+            i = (i + 1) & mask_;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == version) {
+            return ports;
+        }
+    }
+}
+
+uint64_t GroupTable::egressPorts(int port, uint16_t vlan, const u_char* frame, int length) {
+    constexpr int kEth = int(sizeof(struct ether_header));
+    const auto* eth = reinterpret_cast<const struct ether_header*>(frame);
+    if (length < kEth + int(sizeof(struct ip)) || eth->ether_type != htons(ETHERTYPE_IP)) {
+        return kFlood;
+    }
+    const u_char* ip = frame + kEth;
+    int headerLength = (ip[0] & 0x0F) * 4;
+    if ((ip[0] >> 4) != 4 || headerLength < int(sizeof(struct ip)) || kEth + headerLength > length) {
+        return kFlood;
+    }
+    uint32_t group = readU32(ip + offsetof(struct ip, ip_dst));
+    if (!isMulticast(group)) {
+        return kFlood;
+    }
+
+    if (ip[offsetof(struct ip, ip_p)] == IPPROTO_IGMP) {
+        int total = std::min<int>(readU16(ip + offsetof(struct ip, ip_len)), length - kEth);
+        if (total <= headerLength) {
+            return kFlood;
+        }
+        const u_char* igmp = ip + headerLength;
+        snoop(port, vlan, igmp, size_t(total - headerLength), readU32(ip + offsetof(struct ip, ip_src)));
+        // Запросы должны дойти до всех хостов, отчёты и выходы — только до маршрутизаторов
+        if (igmp[0] == kMembershipQuery) {
+            return kFlood;
+        }
+        uint64_t queriers = querierPorts_.load(std::memory_order_relaxed);
+        return queriers ? queriers : kFlood;
+    }
+
+    if (isLinkLocalGroup(group)) {
+        return kFlood;
+    }
+    uint64_t members = lookup(groupKey(vlan, group));
+    if (members == 0 && options_.floodUnregistered) {
+        return kFlood;
+    }
+    return members | querierPorts_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Разбирает сообщение IGMP и обновляет членство
+ * @param port Порт приёма
+ * @param vlan VLAN сообщения
+ * @param igmp Начало сообщения IGMP
+ * @param length Длина сообщения
+ * @param ipSource Адрес отправителя (у запроса «0.0.0.0» нет опросчика)
+ */
+void GroupTable::snoop(int port, uint16_t vlan, const u_char* igmp, size_t length, uint32_t ipSource) {
+    if (length < 8 || size_t(port) >= ports_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t now = nowSec();
+
+    switch (igmp[0]) {
+        case kMembershipQuery:
+            if (ipSource != 0) {
+                querierExpires_[port] = now + options_.querierTimeoutSec;
+                querierPorts_.fetch_or(uint64_t(1) << port, std::memory_order_relaxed);
+            }
+            break;
+        case kV1Report:
+        case kV2Report:
+            join(vlan, readU32(igmp + 4), port, now);
+            break;
+        case kV2Leave:
+            leave(vlan, readU32(igmp + 4), port, now);
+            break;
+        case kV3Report: {
+            size_t records = readU16(igmp + 6);
+            size_t offset = 8;
+            for (size_t r = 0; r < records && offset + 8 <= length; ++r) {
+                uint8_t type = igmp[offset];
+                size_t auxWords = igmp[offset + 1];
+                size_t sources = readU16(igmp + offset + 2);
+                uint32_t group = readU32(igmp + offset + 4);
+                if (type == kModeIsExclude || type == kChangeToExclude ||
+                    ((type == kModeIsInclude || type == kAllowNewSources) && sources > 0)) {
+                    join(vlan, group, port, now);
+                } else if ((type == kModeIsInclude || type == kChangeToInclude) && sources == 0) {
+                    leave(vlan, group, port, now);
+                }
+                offset += 8 + 4 * sources + 4 * auxWords;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @note Вызывается под мьютексом
+ */
+void GroupTable::join(uint16_t vlan, uint32_t group, int port, uint32_t now) {
+    if (!isMulticast(group) || isLinkLocalGroup(group)) {
+        return;
+    }
+    auto it = groups_.find(groupKey(vlan, group));
+    if (it == groups_.end()) {
+        if (groups_.size() >= options_.capacity) {
+            return;
+        }
+        it = groups_.emplace(groupKey(vlan, group), std::vector<uint32_t>(ports_, 0)).first;
+    }
+    bool wasMember = it->second[port] != 0;
+    it->second[port] = now + options_.membershipTimeoutSec;
+    if (!wasMember) {
+        rebuild();
+    }
+}
+
+/**
+ * @note Вызывается под мьютексом. Порт остаётся членом ещё leaveTimeout секунд:
+ *       другие хосты за ним успеют ответить на запрос маршрутизатора
+ */
+void GroupTable::leave(uint16_t vlan, uint32_t group, int port, uint32_t now) {
+    auto it = groups_.find(groupKey(vlan, group));
+    if (it != groups_.end() && it->second[port] != 0) {
+        it->second[port] = std::min(it->second[port], now + options_.leaveTimeoutSec);
+    }
+}
+
+/**
+ * @brief Перестраивает таблицу пересылки по состоянию групп
+ * @note Вызывается под мьютексом; на время перестройки счётчик версий нечётный
+ */
+void GroupTable::rebuild() {
+    uint32_t version = seq_.load(std::memory_order_relaxed);
+    seq_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i <= mask_; ++i) {
+        slots_[i].key.store(0, std::memory_order_relaxed);
+    }
+    for (const auto& entry : groups_) {
+        uint64_t ports = 0;
+        for (size_t p = 0; p < ports_; ++p) {
+            if (entry.second[p] != 0) {
+                ports |= uint64_t(1) << p;
+            }
+        }
+        size_t i = homeSlot(entry.first);
+        while (slots_[i].key.load(std::memory_order_relaxed) != 0) {
+            i = (i + 1) & mask_;
+        }
+        slots_[i].ports.store(ports, std::memory_order_relaxed);
+        slots_[i].key.store(entry.first, std::memory_order_relaxed);
+    }
+
+    seq_.store(version + 2, std::memory_order_release);
+}
+
+void GroupTable::ageEntries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t now = nowSec();
+
+    bool changed = false;
+    for (auto it = groups_.begin(); it != groups_.end();) {
+        bool any = false;
+        for (auto& expires : it->second) {
+            if (expires != 0 && expires <= now) {
+                expires = 0;
+                changed = true;
+            }
+            any = any || expires != 0;
+        }
+        it = any ? std::next(it) : groups_.erase(it);
+    }
+    if (changed) {
+        rebuild();
+    }
+
+    uint64_t queriers = 0;
+    for (size_t p = 0; p < ports_; ++p) {
+        if (querierExpires_[p] != 0 && querierExpires_[p] <= now) {
+            querierExpires_[p] = 0;
+        }
+        if (querierExpires_[p] != 0) {
+            queriers |= uint64_t(1) << p;
+        }
+    }
+    querierPorts_.store(queriers, std::memory_order_relaxed);
+}
+
+size_t GroupTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return groups_.size();
+}
+
+void GroupTable::printTable() const {
+    std::vector<std::pair<uint64_t, std::vector<uint32_t>>> groups;
+    std::vector<uint32_t> queriers;
+    uint32_t now;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        groups.assign(groups_.begin(), groups_.end());
+        queriers = querierExpires_;
+        now = nowSec();
+    }
+
+    auto ip = [](uint32_t address) {
+        struct in_addr addr{htonl(address)};
+        char buf[INET_ADDRSTRLEN];
+        return std::string(inet_ntop(AF_INET, &addr, buf, sizeof(buf)));
+    };
+    std::ostringstream out;
+    out << "\n=== IGMP groups (" << groups.size() << ") ===\n" << "Querier ports:";
+    for (size_t p = 0; p < queriers.size(); ++p) {
+        if (queriers[p] != 0) {
+            out << " " << p << " (" << queriers[p] - now << " s)";
+        }
+    }
+    out << "\n" << std::left << std::setw(8) << "VLAN" << std::setw(18) << "Group" << "Ports (expires in, s)\n";
+    for (const auto& group : groups) {
+        out << std::left << std::setw(8) << (group.first >> 32) << std::setw(18) << ip(uint32_t(group.first));
+        for (size_t p = 0; p < group.second.size(); ++p) {
+            if (group.second[p] != 0) {
+                out << " " << p << " (" << group.second[p] - now << ")";
+            }
+        }
+        out << "\n";
+    }
+    out << "=============================";
+    std::cout << out.str() << std::endl;
+}
@@ -0,0 +1,123 @@
+#ifndef GROUP_TABLE_H
+#define GROUP_TABLE_H
+
+#include "../Headers.h"
+
+/**
+ * @class GroupTable
+ * @brief Таблица групп IPv4 multicast, заполняемая прослушиванием IGMP (IGMP snooping)
+ *
+ * Коммутатор разбирает сообщения IGMPv1/v2/v3, проходящие через него:
+ * отчёт о членстве добавляет порт приёма в группу, выход из группы (v2 Leave,
+ * v3 TO_IN без источников) сокращает срок членства порта до leaveTimeout —
+ * за это время остальные хосты за портом успевают ответить на запрос
+ * маршрутизатора. Порт, на котором принят общий запрос (Membership Query),
+ * считается портом маршрутизатора-опросчика (querier).
+ *
+ * Группы различаются по VLAN: отчёт в одном VLAN не открывает группу в другом.
+ * Кадры группы уходят только в порты её членов и в порты опросчиков;
+ * группы 224.0.0.0/24 (служебные протоколы) и сами запросы рассылаются
+ * во все порты, отчёты и выходы — только опросчикам. Членство и опросчики
+ * устаревают без повторных сообщений (ageEntries()).
+ *
+ * Состояние меняют только писатели под мьютексом (сообщения IGMP и старение).
+ * Для пути пересылки после каждого изменения заново строится плоская
+ * хэш-таблица «(VLAN, группа) → маска портов»; поиск в ней не берёт блокировку
+ * и повторяется, если во время него таблица перестраивалась (счётчик версий).
+ * Маска портов — 64 бита, поэтому таблица поддерживает до kMaxPorts портов.
+ */
+class GroupTable {
+public:
+    /// Максимальное число портов
+    static constexpr size_t kMaxPorts = 64;
+    /// Маска «все порты»: кадр рассылается как раньше
+    static constexpr uint64_t kFlood = ~0ull;
+
+    /**
+     * @struct Options
+     * @brief Параметры прослушивания (igmp_* в switch.cfg)
+     */
+    struct Options {
+        size_t capacity = 1024;             ///< Максимальное число групп
+        uint32_t membershipTimeoutSec = 260; ///< Срок членства без повторного отчёта (2 * 125 + 10 с)
+        uint32_t querierTimeoutSec = 255;    ///< Срок порта опросчика без новых запросов
+        uint32_t leaveTimeoutSec = 2;        ///< Срок членства порта после выхода из группы
+        bool floodUnregistered = false;      ///< Рассылать кадры групп без членов во все порты
+    };
+
+    /**
+     * @brief Создаёт пустую таблицу
+     * @param ports Число портов (не больше kMaxPorts)
+     * @param options Параметры прослушивания
+     */
+    GroupTable(size_t ports, const Options& options);
+
+    GroupTable(const GroupTable&) = delete;
+    GroupTable& operator=(const GroupTable&) = delete;
+
+    /**
+     * @brief Выбирает порты для группового кадра IPv4 и разбирает сообщения IGMP
+     * @param port Порт приёма
+     * @param vlan VLAN кадра
+     * @param frame Кадр Ethernet без тега VLAN с групповым адресом назначения
+     * @param length Длина кадра
+     * @return Маска портов назначения (порт приёма и порты вне VLAN исключает вызывающий) или kFlood
+     * @note Без блокировок, кроме кадров IGMP
+     */
+    uint64_t egressPorts(int port, uint16_t vlan, const u_char* frame, int length);
+
+    /**
+     * @brief Удаляет устаревшее членство и опросчиков (раз в секунду)
+     */
+    void ageEntries();
+
+    /**
+     * @brief Выводит группы, их порты и порты опросчиков
+     */
+    void printTable() const;
+
+    /**
+     * @brief Число групп с членами
+     */
+    size_t size() const;
+
+private:
+    /**
+     * @struct Slot
+     * @brief Ячейка таблицы пересылки
+     */
+    struct Slot {
+        std::atomic<uint64_t> key{0};   ///< groupKey(), 0 — пустая ячейка
+        std::atomic<uint64_t> ports{0}; ///< Маска портов членов
+    };
+
+    /**
+     * @brief Ключ группы: VLAN в старших 32 битах, адрес (порядок байт хоста) в младших
+     */
+    static uint64_t groupKey(uint16_t vlan, uint32_t group) { return (uint64_t(vlan) << 32) | group; }
+
+    uint32_t nowSec() const;
+    size_t homeSlot(uint64_t key) const;
+    uint64_t lookup(uint64_t key) const;
+    void snoop(int port, uint16_t vlan, const u_char* igmp, size_t length, uint32_t ipSource);
+    void join(uint16_t vlan, uint32_t group, int port, uint32_t now);
+    void leave(uint16_t vlan, uint32_t group, int port, uint32_t now);
+    void rebuild();
+
+    size_t ports_;                                 ///< Число портов
+    Options options_;                              ///< Параметры
+    std::chrono::steady_clock::time_point epoch_;  ///< Точка отсчёта времени
+
+    // Состояние (под мьютексом): срок членства каждого порта в каждой группе
+    mutable std::mutex mutex_;
+    std::map<uint64_t, std::vector<uint32_t>> groups_; ///< groupKey() -> срок по портам (0 — не член)
+    std::vector<uint32_t> querierExpires_;             ///< Срок порта опросчика (0 — не опросчик)
+
+    // Таблица пересылки (читается без блокировки)
+    std::unique_ptr<Slot[]> slots_;           ///< Ячейки (число — степень двойки)
+    size_t mask_ = 0;                         ///< Число ячеек минус 1
+    std::atomic<uint64_t> querierPorts_{0};   ///< Маска портов опросчиков
+    alignas(64) std::atomic<uint32_t> seq_{0}; ///< Счётчик версий: нечётный во время перестройки
+};
+
+#endif // GROUP_TABLE_H
@@ -0,0 +1,60 @@
+#include "IoPort.h"
+#include <linux/if_packet.h>
+
+int openTxSocket(const std::string& iface) {
+    int ifindex = static_cast<int>(if_nametoindex(iface.c_str()));
+    if (ifindex == 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_ll addr{};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = 0;
+    addr.sll_ifindex = ifindex;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+size_t IoPort::sendToSocket(int fd, const TxFrame* frames, size_t count) {
+    constexpr size_t kChunk = 64;
+    struct iovec iov[kChunk];
+    struct mmsghdr messages[kChunk];
+
+    size_t sent = 0, bytes = 0;
+    for (size_t base = 0; base < count; base += kChunk) {
+        size_t chunk = std::min(kChunk, count - base);
+        for (size_t i = 0; i < chunk; ++i) {
+            iov[i] = {const_cast<u_char*>(frames[base + i].data), frames[base + i].length};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        // sendmmsg может отправить только часть пачки; кадр, на котором отправка
+        // остановилась с ошибкой, пропускаем и продолжаем с остальными
+        size_t next = 0;
+        while (next < chunk) {
+            int n = sendmmsg(fd, messages + next, unsigned(chunk - next), 0);
+            if (n > 0) {
+                for (int i = 0; i < n; ++i) {
+                    bytes += iov[next + size_t(i)].iov_len;
+                }
+                sent += size_t(n);
+                next += size_t(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                ++next;
+            }
+        }
+    }
+    countTx(sent, bytes, count - sent);
+    return sent;
+}
@@ -0,0 +1,157 @@
+#ifndef IO_PORT_H
+#define IO_PORT_H
+
+#include "../Headers.h"
+
+/**
+ * @brief Открывает сокет AF_PACKET для отправки кадров в интерфейс
+ * @param iface Имя интерфейса
+ * @return Дескриптор сокета или -1 при ошибке
+ *
+ * Сокет создаётся с протоколом 0, поэтому ядро не доставляет в него входящие кадры.
+ */
+int openTxSocket(const std::string& iface);
+
+/**
+ * @struct IoPortStats
+ * @brief Снимок счётчиков порта ввода-вывода
+ */
+struct IoPortStats {
+    uint64_t rxFrames = 0;  ///< Принято кадров
+    uint64_t rxBytes = 0;   ///< Принято байт (по длине кадра в сети)
+    uint64_t txFrames = 0;  ///< Отправлено кадров
+    uint64_t txBytes = 0;   ///< Отправлено байт
+    uint64_t txErrors = 0;  ///< Кадров, которые не удалось отправить
+};
+
+/**
+ * @class IoPort
+ * @brief Способ приёма и отправки кадров одного порта коммутатора
+ *
+ * Логика коммутации работает только через этот интерфейс: приём пачки кадров,
+ * отправка пачки кадров и счётчики. Реализации — libpcap (PcapPort), кольцо
+ * AF_PACKET TPACKET_V3 (RingPort) и очередь в памяти процесса (MemoryPort),
+ * на которой можно собрать коммутатор из N виртуальных портов без сетевых карт.
+ *
+ * Принимает кадры один поток, отправляет — тоже один (поток отправки Egress),
+ * поэтому счётчики каждой стороны обновляются без атомарных сложений.
+ */
+class IoPort {
+public:
+    /**
+     * @brief Обработчик принятого кадра (по образцу pcap_handler)
+     * @param user Аргумент, переданный в receiveBurst()
+     * @param data Данные кадра; действительны только внутри обработчика
+     * @param caplen Число принятых байт
+     * @param len Длина кадра в сети
+     */
+    using FrameHandler = void (*)(void* user, u_char* data, uint32_t caplen, uint32_t len);
+
+    /**
+     * @struct TxFrame
+     * @brief Кадр для отправки
+     */
+    struct TxFrame {
+        const u_char* data; ///< Данные кадра
+        uint32_t length;    ///< Длина кадра
+    };
+
+    explicit IoPort(std::string name) : name_(std::move(name)) {}
+    virtual ~IoPort() = default;
+
+    IoPort(const IoPort&) = delete;
+    IoPort& operator=(const IoPort&) = delete;
+
+    /**
+     * @brief Имя порта (имя интерфейса для настоящих портов)
+     */
+    const std::string& name() const { return name_; }
+
+    /**
+     * @brief Принимает очередную пачку кадров и передаёт их обработчику
+     * @param max Желаемый максимум кадров (кольцо отдаёт готовый блок целиком)
+     * @param timeoutMs Сколько ждать кадров, мс (0 — не ждать)
+     * @param handler Обработчик кадра
+     * @param user Аргумент обработчика
+     * @return Число принятых кадров или -1 при ошибке (текст в lastError())
+     */
+    virtual int receiveBurst(size_t max, int timeoutMs, FrameHandler handler, void* user) = 0;
+
+    /**
+     * @brief Отправляет пачку кадров
+     * @return Число отправленных кадров (неотправленные учитываются в txErrors)
+     */
+    virtual size_t sendBurst(const TxFrame* frames, size_t count) = 0;
+
+    /**
+     * @brief Можно ли изменять принятый кадр на месте, внутри обработчика
+     */
+    virtual bool framesWritable() const = 0;
+
+    /**
+     * @brief Дескриптор для epoll/poll, -1 — порт не поддерживает ожидание
+     */
+    virtual int selectableFd() const { return -1; }
+
+    /**
+     * @brief Переводит приём в неблокирующий режим (receiveBurst не ждёт кадров)
+     * @throws std::runtime_error Если порт не поддерживает неблокирующий приём
+     */
+    virtual void setNonblocking() {
+        throw std::runtime_error("Port " + name_ + " does not support non-blocking receive");
+    }
+
+    /**
+     * @brief Текст последней ошибки приёма
+     */
+    virtual std::string lastError() const { return {}; }
+
+    /**
+     * @brief Снимок счётчиков порта
+     */
+    IoPortStats stats() const {
+        IoPortStats s;
+        s.rxFrames = rxFrames_.load(std::memory_order_relaxed);
+        s.rxBytes = rxBytes_.load(std::memory_order_relaxed);
+        s.txFrames = txFrames_.load(std::memory_order_relaxed);
+        s.txBytes = txBytes_.load(std::memory_order_relaxed);
+        s.txErrors = txErrors_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+protected:
+    /**
+     * @brief Учитывает принятые кадры (вызывается только потоком приёма)
+     */
+    void countRx(uint64_t frames, uint64_t bytes) {
+        rxFrames_.store(rxFrames_.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+        rxBytes_.store(rxBytes_.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Учитывает отправку пачки (вызывается только потоком отправки)
+     */
+    void countTx(uint64_t frames, uint64_t bytes, uint64_t errors) {
+        txFrames_.store(txFrames_.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+        txBytes_.store(txBytes_.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        if (errors) {
+            txErrors_.store(txErrors_.load(std::memory_order_relaxed) + errors, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Отправляет пачку кадров через сокет AF_PACKET одним или несколькими sendmmsg
+     * @return Число отправленных кадров; счётчики отправки обновляются
+     */
+    size_t sendToSocket(int fd, const TxFrame* frames, size_t count);
+
+private:
+    std::string name_;                                  ///< Имя порта
+    alignas(64) std::atomic<uint64_t> rxFrames_{0};     ///< Счётчики приёма
+    std::atomic<uint64_t> rxBytes_{0};
+    alignas(64) std::atomic<uint64_t> txFrames_{0};     ///< Счётчики отправки
+    std::atomic<uint64_t> txBytes_{0};
+    std::atomic<uint64_t> txErrors_{0};
+};
+
+#endif // IO_PORT_H
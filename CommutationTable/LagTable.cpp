@@ -0,0 +1,156 @@
+#include "LagTable.h"
+#include "RuleTable.h"
+#include "NetworkUtils/NetworkUtils.h"
+
+namespace {
+
+    std::string trim(const std::string& str) {
+        size_t first = str.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            return "";
+        }
+        return str.substr(first, str.find_last_not_of(" \t") - first + 1);
+    }
+
+    /**
+     * @brief Перемешивание битов (финализатор MurmurHash3): близкие ключи дают далёкие хэши
+     */
+    uint64_t mix(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+} // namespace
+
+LagHashPolicy parseLagHashPolicy(const std::string& str) {
+    if (str == "layer2") {
+        return LagHashPolicy::Layer2;
+    }
+    if (str == "layer2+3") {
+        return LagHashPolicy::Layer23;
+    }
+    if (str == "layer3+4") {
+        return LagHashPolicy::Layer34;
+    }
+    throw std::invalid_argument("Unknown LAG hash policy: " + str);
+}
+
+std::vector<std::pair<std::string, std::vector<int>>> parseLagGroups(const std::string& str,
+                                                                     const std::vector<std::string>& names) {
+    std::vector<std::pair<std::string, std::vector<int>>> groups;
+    std::istringstream items(str);
+    std::string item;
+    while (std::getline(items, item, ';')) {
+        if (trim(item).empty()) {
+            continue;
+        }
+        size_t colon = item.find(':');
+        std::string name = trim(item.substr(0, colon));
+        if (colon == std::string::npos || name.empty()) {
+            throw std::invalid_argument("Invalid LAG group: " + trim(item));
+        }
+        std::vector<int> members;
+        std::istringstream ports(item.substr(colon + 1));
+        std::string port;
+        while (std::getline(ports, port, ',')) {
+            port = trim(port);
+            auto it = std::find(names.begin(), names.end(), port);
+            if (it == names.end()) {
+                throw std::invalid_argument("Unknown port in LAG " + name + ": " + port);
+            }
+            members.push_back(int(it - names.begin()));
+        }
+        groups.emplace_back(name, std::move(members));
+    }
+    return groups;
+}
+
+LagTable::LagTable(size_t ports, LagHashPolicy policy)
+    : policy_(policy),
+      logical_(ports),
+      group_(ports, -1) {
+    for (size_t i = 0; i < ports; ++i) {
+        logical_[i] = int(i);
+    }
+}
+
+void LagTable::addGroup(const std::string& name, std::vector<int> members) {
+    std::sort(members.begin(), members.end());
+    if (members.size() < 2 || members.size() > kMaxMembers ||
+        std::adjacent_find(members.begin(), members.end()) != members.end()) {
+        throw std::invalid_argument("LAG " + name + " needs 2 to " + std::to_string(kMaxMembers) +
+                                    " distinct ports");
+    }
+    for (int port : members) {
+        if (group_[size_t(port)] >= 0) {
+            throw std::invalid_argument("Port " + std::to_string(port) + " is already in LAG " +
+                                        groups_[size_t(group_[size_t(port)])].name);
+        }
+    }
+
+    groups_.emplace_back();
+    Group& group = groups_.back();
+    group.name = name;
+    group.members = members;
+    group.up.store(members.size() == kMaxMembers ? ~0ull : (1ull << members.size()) - 1,
+                   std::memory_order_relaxed);
+    for (int port : members) {
+        group_[size_t(port)] = int(groups_.size() - 1);
+        logical_[size_t(port)] = members.front();
+    }
+}
+
+uint32_t LagTable::flowHash(const u_char* frame, int length) const {
+    const uint64_t dst = utils::macToU64(frame);
+    const uint64_t src = utils::macToU64(frame + 6);
+    FlowKey key;
+    if (policy_ == LagHashPolicy::Layer2 || !RuleTable::extractKey(frame, uint32_t(length), key)) {
+        return uint32_t(mix(src ^ (dst << 16) ^ (dst >> 32)));
+    }
+
+    uint64_t value = (uint64_t(key.src) << 32 | key.dst) ^ (uint64_t(key.proto) << 56);
+    if (policy_ == LagHashPolicy::Layer23) {
+        value ^= mix(src ^ (dst << 16) ^ (dst >> 32));
+    } else {
+        // Порты есть только в первом фрагменте: у фрагментированных пакетов хэш по адресам,
+        // иначе фрагменты одного пакета ушли бы по разным каналам
+        const auto* ip = reinterpret_cast<const struct ip*>(frame + sizeof(struct ether_header));
+        if ((ntohs(ip->ip_off) & (IP_MF | IP_OFFMASK)) == 0) {
+            value ^= uint64_t(key.srcPort) << 16 | key.dstPort;
+        }
+    }
+    return uint32_t(mix(value));
+}
+
+bool LagTable::setLinkUp(int port, bool up) {
+    Group& group = groups_[size_t(group_[size_t(port)])];
+    size_t index = size_t(std::find(group.members.begin(), group.members.end(), port) - group.members.begin());
+    uint64_t bit = 1ull << index;
+    uint64_t previous = up ? group.up.fetch_or(bit, std::memory_order_relaxed)
+                           : group.up.fetch_and(~bit, std::memory_order_relaxed);
+    return ((previous & bit) != 0) != up;
+}
+
+int LagTable::activeLinks(int port) const {
+    return __builtin_popcountll(groups_[size_t(group_[size_t(port)])].up.load(std::memory_order_relaxed));
+}
+
+void LagTable::print(const std::vector<std::string>& names) const {
+    static const char* const kPolicies[] = {"layer2", "layer2+3", "layer3+4"};
+    std::ostringstream out;
+    out << "Link aggregation (hash " << kPolicies[size_t(policy_)] << "):";
+    for (const Group& group : groups_) {
+        uint64_t up = group.up.load(std::memory_order_relaxed);
+        out << "\n  " << std::left << std::setw(12) << group.name;
+        for (size_t i = 0; i < group.members.size(); ++i) {
+            size_t port = size_t(group.members[i]);
+            out << (i ? ", " : "") << (port < names.size() ? names[port] : std::to_string(port))
+                << ((up >> i) & 1 ? "" : " (down)");
+        }
+    }
+    std::cout << out.str() << std::endl;
+}
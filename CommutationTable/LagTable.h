@@ -0,0 +1,159 @@
+#ifndef LAG_TABLE_H
+#define LAG_TABLE_H
+
+#include "../Headers.h"
+#include <deque>
+
+/**
+ * @enum LagHashPolicy
+ * @brief Поля кадра, по которым выбирается канал группы
+ */
+enum class LagHashPolicy {
+    Layer2,   ///< MAC-адреса источника и назначения
+    Layer23,  ///< MAC-адреса и адреса IPv4
+    Layer34,  ///< Адреса IPv4, протокол и порты TCP/UDP (для остальных кадров — MAC-адреса)
+};
+
+/**
+ * @brief Разбирает значение lag_hash_policy: layer2, layer2+3 или layer3+4
+ * @throws std::invalid_argument Если политика неизвестна
+ */
+LagHashPolicy parseLagHashPolicy(const std::string& str);
+
+/**
+ * @brief Разбирает список групп вида "po1: eth1, eth2; po2: eth3, eth4"
+ * @param str Значение lag_groups
+ * @param names Имена портов по номерам
+ * @return Имя и номера портов каждой группы
+ * @throws std::invalid_argument Если порт не найден, повторяется или в группе меньше двух портов
+ */
+std::vector<std::pair<std::string, std::vector<int>>> parseLagGroups(const std::string& str,
+                                                                     const std::vector<std::string>& names);
+
+/**
+ * @class LagTable
+ * @brief Статическое агрегирование каналов (LAG): несколько портов работают как один логический порт
+ *
+ * Логический порт группы — её порт с наименьшим номером: на него записываются
+ * MAC-адреса, изученные на любом порту группы, и его номер хранят таблица
+ * коммутации, кэш решений и таблица групп IGMP. Порт отправки выбирается среди
+ * работающих портов группы по хэшу полей потока, поэтому кадры одного потока
+ * идут по одному каналу и не переупорядочиваются.
+ *
+ * Состав групп задаётся до запуска потоков захвата и потом не меняется. Состояние
+ * каналов — атомарная маска, которую поток обслуживания обновляет по состоянию
+ * интерфейсов: при падении канала на другие переходят только его потоки, потоки
+ * работающих каналов остаются на месте.
+ */
+class LagTable {
+public:
+    /// Наибольшее число портов в группе (маска работающих каналов — 64 бита)
+    static constexpr size_t kMaxMembers = 64;
+
+    /**
+     * @brief Создаёт таблицу без групп
+     * @param ports Число портов
+     * @param policy Поля кадра для выбора канала
+     */
+    LagTable(size_t ports, LagHashPolicy policy);
+
+    LagTable(const LagTable&) = delete;
+    LagTable& operator=(const LagTable&) = delete;
+
+    /**
+     * @brief Объединяет порты в группу; все каналы считаются работающими
+     * @param name Имя группы
+     * @param members Номера портов, ещё не входящих в группы
+     * @throws std::invalid_argument Если порт уже в группе или портов меньше двух
+     */
+    void addGroup(const std::string& name, std::vector<int> members);
+
+    /**
+     * @brief Логический порт: порт группы с наименьшим номером или сам порт вне групп
+     */
+    int logical(int port) const { return logical_[size_t(port)]; }
+
+    /**
+     * @brief Входит ли порт в группу
+     */
+    bool isMember(int port) const { return group_[size_t(port)] >= 0; }
+
+    /**
+     * @brief Выбирает канал группы для потока
+     * @param port Логический порт группы
+     * @param hash Хэш потока (flowHash())
+     * @return Номер порта отправки, -1 — ни один канал группы не работает
+     */
+    int select(int port, uint32_t hash) const {
+        const Group& group = groups_[size_t(group_[size_t(port)])];
+        uint64_t up = group.up.load(std::memory_order_relaxed);
+        // Постоянный канал потока: пока он работает, падение и возврат других каналов поток не трогают
+        const unsigned size = unsigned(group.members.size());
+        const unsigned slot = hash % size;
+        if ((up >> slot) & 1) {
+            return group.members[slot];
+        }
+        if (up == 0) {
+            return -1;
+        }
+        // Канал упал: его потоки распределяются по работающим каналам по оставшимся битам хэша
+        for (unsigned k = (hash / size) % unsigned(__builtin_popcountll(up)); k > 0; --k) {
+            up &= up - 1;
+        }
+        return group.members[size_t(__builtin_ctzll(up))];
+    }
+
+    /**
+     * @brief Хэш потока кадра по политике таблицы
+     * @param frame Кадр Ethernet без тега VLAN
+     * @param length Длина кадра
+     */
+    uint32_t flowHash(const u_char* frame, int length) const;
+
+    /**
+     * @brief Отмечает канал работающим или упавшим
+     * @param port Порт группы
+     * @param up Работает ли канал
+     * @return true, если состояние канала изменилось
+     */
+    bool setLinkUp(int port, bool up);
+
+    /**
+     * @brief Имя группы порта
+     */
+    const std::string& groupName(int port) const { return groups_[size_t(group_[size_t(port)])].name; }
+
+    /**
+     * @brief Число работающих каналов группы порта
+     */
+    int activeLinks(int port) const;
+
+    /**
+     * @brief Есть ли хотя бы одна группа
+     */
+    bool empty() const { return groups_.empty(); }
+
+    /**
+     * @brief Выводит состав групп и состояние каналов
+     * @param names Имена портов по номерам
+     */
+    void print(const std::vector<std::string>& names) const;
+
+private:
+    /**
+     * @struct Group
+     * @brief Группа портов
+     */
+    struct Group {
+        std::string name;              ///< Имя группы
+        std::vector<int> members;      ///< Порты по возрастанию, первый — логический порт
+        std::atomic<uint64_t> up{0};   ///< Работающие каналы: бит i — members[i]
+    };
+
+    LagHashPolicy policy_;          ///< Поля кадра для выбора канала
+    std::vector<int> logical_;      ///< Логический порт каждого порта
+    std::vector<int> group_;        ///< Группа каждого порта, -1 — вне групп
+    std::deque<Group> groups_;      ///< Группы (deque: Group с атомарным полем не перемещается)
+};
+
+#endif // LAG_TABLE_H
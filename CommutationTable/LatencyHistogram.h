@@ -0,0 +1,154 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * @brief Логарифмически-линейная гистограмма задержек фиксированного размера (в стиле HDR)
+ *
+ * Значения до kSubCount наносекунд хранятся точно, далее каждый диапазон [2^e, 2^(e+1))
+ * делится на kSubCount равных корзин, что даёт относительную погрешность не больше 1/kSubCount.
+ * Память постоянна и не зависит от числа записанных значений.
+ *
+ * Гистограмма рассчитана на одного писателя: счётчики увеличиваются обычной парой
+ * load/store без атомарных RMW. Читать можно из любого потока, снимок при этом
+ * может отставать на несколько значений.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBits = 5;                       ///< log2 числа корзин на октаву
+    static constexpr uint64_t kSubCount = 1ull << kSubBits;       ///< Корзин на октаву
+    static constexpr unsigned kMaxExp = 40;                       ///< Верхняя граница ~2^40 нс (18 минут)
+    static constexpr size_t kBuckets = (kMaxExp - kSubBits + 2) * kSubCount;
+
+    /**
+     * @struct Snapshot
+     * @brief Копия гистограммы для объединения и вычисления перцентилей
+     */
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{}; ///< Счётчики корзин
+        uint64_t total = 0;                      ///< Число значений
+        uint64_t max = 0;                        ///< Максимальное значение, нс
+
+        /**
+         * @brief Возвращает значение перцентиля
+         * @param percent Перцентиль в процентах (например, 99.9)
+         * @return Верхняя граница корзины, в которую попал перцентиль, нс
+         */
+        uint64_t percentile(double percent) const {
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(percent / 100.0 * double(total) + 0.5);
+            rank = rank == 0 ? 1 : (rank > total ? total : rank);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    uint64_t upper = bucketUpperBound(i);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+
+        /**
+         * @brief Добавляет к снимку другой снимок
+         */
+        void merge(const Snapshot& other) {
+            for (size_t i = 0; i < kBuckets; ++i) {
+                counts[i] += other.counts[i];
+            }
+            total += other.total;
+            if (other.max > max) {
+                max = other.max;
+            }
+        }
+    };
+
+    /**
+     * @brief Записывает значение (только из потока-владельца)
+     * @param value Значение в наносекундах
+     */
+    void record(uint64_t value) {
+        auto& bucket = counts_[bucketIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_.store(total_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Записывает значение из нескольких потоков (атомарными RMW)
+     * @param value Значение в наносекундах
+     */
+    void recordShared(uint64_t value) {
+        counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (value > prev && !max_.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief Добавляет текущее содержимое гистограммы к снимку
+     */
+    void addTo(Snapshot& snapshot) const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            uint64_t c = counts_[i].load(std::memory_order_relaxed);
+            snapshot.counts[i] += c;
+            total += c;
+        }
+        // Считаем total по корзинам, чтобы перцентили были согласованы со счётчиками
+        snapshot.total += total;
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        if (max > snapshot.max) {
+            snapshot.max = max;
+        }
+    }
+
+    /**
+     * @brief Возвращает число записанных значений
+     */
+    uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Индекс корзины для значения
+     */
+    static size_t bucketIndex(uint64_t value) {
+        if (value < kSubCount) {
+            return size_t(value);
+        }
+        unsigned exp = 63u - unsigned(__builtin_clzll(value));
+        if (exp > kMaxExp) {
+            return kBuckets - 1;
+        }
+        uint64_t sub = (value >> (exp - kSubBits)) & (kSubCount - 1);
+        return size_t(exp - kSubBits + 1) * kSubCount + size_t(sub);
+    }
+
+    /**
+     * @brief Наибольшее значение, попадающее в корзину
+     */
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < kSubCount) {
+            return index;
+        }
+        unsigned exp = unsigned(index / kSubCount) + kSubBits - 1;
+        uint64_t sub = index % kSubCount;
+        uint64_t lower = (1ull << exp) + (sub << (exp - kSubBits));
+        return lower + (1ull << (exp - kSubBits)) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{}; ///< Счётчики корзин
+    std::atomic<uint64_t> total_{0};                      ///< Число значений
+    std::atomic<uint64_t> max_{0};                        ///< Максимальное значение, нс
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,54 @@
+#include "MemoryPort.h"
+
+MemoryPort::MemoryPort(std::string name, size_t depth, size_t frameSize)
+    : IoPort(std::move(name)), frameSize_(frameSize) {
+    size_t capacity = 2;
+    while (capacity < depth) {
+        capacity <<= 1;
+    }
+    mask_ = capacity - 1;
+    stride_ = (offsetof(Slot, data) + frameSize + 63) & ~size_t(63);
+    storage_.resize(capacity * stride_);
+}
+
+bool MemoryPort::inject(const u_char* data, uint32_t length, uint32_t wireLength) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (length > frameSize_ || tail - head_.load(std::memory_order_acquire) > mask_) {
+        return false;
+    }
+    Slot* s = slot(tail);
+    s->length = length;
+    s->wireLength = std::max(length, wireLength);
+    memcpy(s->data, data, length);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+int MemoryPort::receiveBurst(size_t max, int, FrameHandler handler, void* user) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t count = std::min(max, tail_.load(std::memory_order_acquire) - head);
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Slot* s = slot(head + i);
+        bytes += s->wireLength;
+        handler(user, s->data, s->length, s->wireLength);
+    }
+    // Ячейки возвращаются писателю только после обработки всей пачки
+    head_.store(head + count, std::memory_order_release);
+    if (count) {
+        countRx(count, bytes);
+    }
+    return int(count);
+}
+
+size_t MemoryPort::sendBurst(const TxFrame* frames, size_t count) {
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += frames[i].length;
+        if (tap_) {
+            tap_(tapUser_, const_cast<u_char*>(frames[i].data), frames[i].length, frames[i].length);
+        }
+    }
+    countTx(count, bytes, 0);
+    return count;
+}
@@ -0,0 +1,79 @@
+#ifndef MEMORY_PORT_H
+#define MEMORY_PORT_H
+
+#include "IoPort.h"
+
+/**
+ * @class MemoryPort
+ * @brief Виртуальный порт в памяти процесса
+ *
+ * Приём — кольцо ячеек фиксированного размера с одним писателем (inject())
+ * и одним читателем (receiveBurst()); кадр копируется в ячейку, как его
+ * положила бы в память сетевая карта, и обработчик может менять его на месте.
+ * Отправленные кадры только учитываются в счётчиках и, если задан,
+ * передаются обработчику-ответвителю (setTxTap()).
+ *
+ * На таких портах коммутатор из N портов собирается в одном процессе
+ * без сетевых карт и прав root — например, для бенчмарка логики коммутации.
+ */
+class MemoryPort : public IoPort {
+public:
+    /**
+     * @brief Создаёт порт
+     * @param name Имя порта
+     * @param depth Ёмкость очереди приёма, кадров (округляется вверх до степени двойки)
+     * @param frameSize Максимальная длина кадра, байт
+     */
+    MemoryPort(std::string name, size_t depth = 1024, size_t frameSize = 2048);
+
+    /**
+     * @brief Кладёт кадр в очередь приёма порта (копируется)
+     * @param data Данные кадра
+     * @param length Число байт кадра
+     * @param wireLength Длина кадра в сети, если кадр записан не целиком (0 — равна length)
+     * @return false, если очередь заполнена или кадр длиннее frameSize
+     */
+    bool inject(const u_char* data, uint32_t length, uint32_t wireLength = 0);
+
+    /**
+     * @brief Задаёт обработчик, получающий каждый отправленный кадр
+     */
+    void setTxTap(FrameHandler tap, void* user) {
+        tap_ = tap;
+        tapUser_ = user;
+    }
+
+    /**
+     * @brief Передаёт обработчику до max кадров из очереди приёма (никогда не ждёт)
+     */
+    int receiveBurst(size_t max, int timeoutMs, FrameHandler handler, void* user) override;
+    size_t sendBurst(const TxFrame* frames, size_t count) override;
+    bool framesWritable() const override { return true; }
+    void setNonblocking() override {}
+
+private:
+    /**
+     * @struct Slot
+     * @brief Ячейка очереди приёма: длины кадра, за ними данные
+     */
+    struct Slot {
+        uint32_t length;
+        uint32_t wireLength;
+        u_char data[1];
+    };
+
+    Slot* slot(size_t position) {
+        return reinterpret_cast<Slot*>(storage_.data() + (position & mask_) * stride_);
+    }
+
+    std::vector<uint8_t> storage_;               ///< Ячейки очереди приёма
+    size_t mask_ = 0;                            ///< Ёмкость минус 1
+    size_t stride_ = 0;                          ///< Размер ячейки (кратен 64)
+    size_t frameSize_ = 0;                       ///< Максимальная длина кадра
+    alignas(64) std::atomic<size_t> head_{0};    ///< Позиция чтения
+    alignas(64) std::atomic<size_t> tail_{0};    ///< Позиция записи
+    FrameHandler tap_ = nullptr;                 ///< Ответвитель отправленных кадров
+    void* tapUser_ = nullptr;                    ///< Аргумент ответвителя
+};
+
+#endif // MEMORY_PORT_H
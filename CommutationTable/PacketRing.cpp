@@ -0,0 +1,98 @@
+#include "PacketRing.h"
+#include <linux/if_ether.h>
+#include <sys/mman.h>
+
+PacketRing::PacketRing(const std::string& iface, const Options& options) {
+    ifindex_ = static_cast<int>(if_nametoindex(iface.c_str()));
+    if (ifindex_ == 0) {
+        throw std::runtime_error("Unknown interface " + iface + ": " + std::string(strerror(errno)));
+    }
+
+    fd_ = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd_ < 0) {
+        throw std::runtime_error("AF_PACKET socket failed: " + std::string(strerror(errno)));
+    }
+
+    auto fail = [this](const std::string& what) {
+        std::string message = what + ": " + std::string(strerror(errno));
+        if (map_) {
+            munmap(map_, mapSize_);
+        }
+        close(fd_);
+        throw std::runtime_error(message);
+    };
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+        fail("setsockopt(PACKET_VERSION) failed");
+    }
+
+#ifdef PACKET_IGNORE_OUTGOING
+    // Ядро 4.20+ само не кладёт в кольцо исходящие кадры; на старых ядрах их отбрасывает poll()
+    int ignoreOutgoing = 1;
+    setsockopt(fd_, SOL_PACKET, PACKET_IGNORE_OUTGOING, &ignoreOutgoing, sizeof(ignoreOutgoing));
+#endif
+
+    struct tpacket_req3 req{};
+    req.tp_block_size = options.blockSize;
+    req.tp_block_nr = options.blockCount;
+    req.tp_frame_size = options.frameSize;
+    req.tp_frame_nr = (options.blockSize / options.frameSize) * options.blockCount;
+    req.tp_retire_blk_tov = options.blockTimeoutMs;
+    req.tp_feature_req_word = 0;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+        fail("setsockopt(PACKET_RX_RING) failed");
+    }
+
+    mapSize_ = size_t(req.tp_block_size) * req.tp_block_nr;
+    void* map = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd_, 0);
+    if (map == MAP_FAILED) {
+        // MAP_LOCKED требует RLIMIT_MEMLOCK, без него кольцо всё равно работает
+        map = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    }
+    if (map == MAP_FAILED) {
+        fail("mmap of RX ring failed");
+    }
+    map_ = static_cast<uint8_t*>(map);
+
+    blocks_.resize(req.tp_block_nr);
+    for (unsigned i = 0; i < req.tp_block_nr; ++i) {
+        blocks_[i].iov_base = map_ + size_t(i) * req.tp_block_size;
+        blocks_[i].iov_len = req.tp_block_size;
+    }
+
+    struct sockaddr_ll addr{};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex_;
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        fail("bind to " + iface + " failed");
+    }
+
+    // Как и pcap_open_live(..., promisc = 1, ...), переводим интерфейс в неразборчивый режим
+    struct packet_mreq mreq{};
+    mreq.mr_ifindex = ifindex_;
+    mreq.mr_type = PACKET_MR_PROMISC;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+        fail("setsockopt(PACKET_ADD_MEMBERSHIP) failed");
+    }
+
+    // Вступать в группу можно только после bind. Фрагменты IP ядро хэширует только
+    // по адресам и протоколу, поэтому все части датаграммы попадают в одно кольцо
+    // и пересылаются без изменений (PACKET_FANOUT_FLAG_DEFRAG собрал бы их в кадр длиннее MTU)
+    if (options.fanoutGroup >= 0) {
+        int fanout = (options.fanoutGroup & 0xFFFF) | (PACKET_FANOUT_HASH << 16);
+        if (setsockopt(fd_, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) != 0) {
+            fail("setsockopt(PACKET_FANOUT) failed");
+        }
+    }
+}
+
+PacketRing::~PacketRing() {
+    if (map_) {
+        munmap(map_, mapSize_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include "../Headers.h"
+#include <linux/if_packet.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+/**
+ * @class PacketRing
+ * @brief Приём кадров через AF_PACKET с кольцевым буфером TPACKET_V3 в разделяемой памяти
+ *
+ * Ядро складывает кадры в блоки кольца, отображённого в память процесса.
+ * Приложение обрабатывает готовый блок целиком прямо в кольце (без копирования
+ * и без системного вызова на каждый кадр) и возвращает блок ядру.
+ * Принимаются только входящие кадры: исходящие кадры интерфейса пропускаются.
+ *
+ * Несколько колец одного интерфейса с общим Options::fanoutGroup делят его кадры
+ * (PACKET_FANOUT в режиме hash): кадры одного потока всегда попадают в одно кольцо,
+ * поэтому их порядок сохраняется, а кольца можно обрабатывать на разных ядрах.
+ */
+class PacketRing {
+public:
+    /**
+     * @struct Options
+     * @brief Параметры кольцевого буфера
+     */
+    struct Options {
+        unsigned blockSize = 1u << 22;   ///< Размер блока в байтах (кратен размеру страницы)
+        unsigned blockCount = 64;        ///< Число блоков в кольце
+        unsigned frameSize = 2048;       ///< Размер кадра для расчёта tp_frame_nr
+        unsigned blockTimeoutMs = 10;    ///< Через сколько мс ядро отдаёт неполный блок
+        int fanoutGroup = -1;            ///< Группа PACKET_FANOUT интерфейса, -1 — без группы
+    };
+
+    /**
+     * @brief Открывает сокет AF_PACKET на интерфейсе и отображает кольцо в память
+     * @param iface Имя сетевого интерфейса
+     * @param options Параметры кольца
+     * @throws std::runtime_error Если сокет или кольцо не удалось настроить
+     */
+    PacketRing(const std::string& iface, const Options& options);
+
+    /**
+     * @brief Снимает отображение кольца и закрывает сокет
+     */
+    ~PacketRing();
+
+    PacketRing(const PacketRing&) = delete;
+    PacketRing& operator=(const PacketRing&) = delete;
+
+    /**
+     * @brief Обрабатывает очередной готовый блок кольца
+     * @param timeoutMs Сколько ждать готовности блока, мс
+     * @param onFrame Обработчик кадра: onFrame(u_char* data, uint32_t caplen, uint32_t len)
+     * @return Число обработанных кадров (0 — блок не готов за время ожидания)
+     *
+     * Указатель data действителен только внутри обработчика: после возврата
+     * блок отдаётся ядру. До этого обработчик может изменять кадр на месте.
+     */
+    template <typename Handler>
+    size_t poll(int timeoutMs, Handler&& onFrame) {
+        auto* block = reinterpret_cast<tpacket_block_desc*>(blocks_[current_].iov_base);
+        if (!blockReady(block)) {
+            struct pollfd pfd{fd_, POLLIN | POLLERR, 0};
+            if (::poll(&pfd, 1, timeoutMs) <= 0 || !blockReady(block)) {
+                return 0;
+            }
+        }
+
+        const uint32_t count = block->hdr.bh1.num_pkts;
+        auto* frame = reinterpret_cast<tpacket3_hdr*>(
+                reinterpret_cast<uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt);
+        for (uint32_t i = 0; i < count; ++i) {
+            // Исходящие кадры (их отправил сам коммутатор) не обрабатываем повторно
+            auto* addr = reinterpret_cast<const sockaddr_ll*>(
+                    reinterpret_cast<const uint8_t*>(frame) + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+            if (addr->sll_pkttype != PACKET_OUTGOING) {
+                u_char* data = reinterpret_cast<u_char*>(frame) + frame->tp_mac;
+                uint32_t caplen = frame->tp_snaplen;
+                uint32_t len = frame->tp_len;
+                // Ядро снимает тег 802.1Q в tp_vlan_tci: возвращаем его в кадр, как это делает libpcap.
+                // Перед tp_mac за sockaddr_ll всегда есть запас больше 4 байт
+                if ((frame->tp_status & TP_STATUS_VLAN_VALID) && caplen >= 12 &&
+                    frame->tp_mac >= TPACKET_ALIGN(sizeof(tpacket3_hdr)) + sizeof(sockaddr_ll) + 4) {
+                    uint16_t tag[2] = {htons((frame->tp_status & TP_STATUS_VLAN_TPID_VALID) ? frame->hv1.tp_vlan_tpid
+                                                                                           : ETHERTYPE_VLAN),
+                                       htons(uint16_t(frame->hv1.tp_vlan_tci))};
+                    memmove(data - 4, data, 12);
+                    data -= 4;
+                    memcpy(data + 12, tag, sizeof(tag));
+                    caplen += 4;
+                    len += 4;
+                }
+                onFrame(data, caplen, len);
+            }
+            frame = reinterpret_cast<tpacket3_hdr*>(reinterpret_cast<uint8_t*>(frame) + frame->tp_next_offset);
+        }
+
+        // Возвращаем блок ядру только после того, как все кадры прочитаны
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        current_ = (current_ + 1) % blocks_.size();
+        return count;
+    }
+
+    /**
+     * @brief Дескриптор сокета AF_PACKET
+     */
+    int fd() const { return fd_; }
+
+    /**
+     * @brief Индекс интерфейса
+     */
+    int ifindex() const { return ifindex_; }
+
+private:
+    static bool blockReady(tpacket_block_desc* block) {
+        return (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) != 0;
+    }
+
+    int fd_ = -1;                    ///< Сокет AF_PACKET
+    int ifindex_ = 0;                ///< Индекс интерфейса
+    uint8_t* map_ = nullptr;         ///< Отображённое кольцо
+    size_t mapSize_ = 0;             ///< Размер отображения
+    std::vector<iovec> blocks_;      ///< Начала блоков кольца
+    size_t current_ = 0;             ///< Блок, ожидаемый следующим
+};
+
+#endif // PACKET_RING_H
@@ -0,0 +1,64 @@
+#include "PcapPort.h"
+#include <climits>
+
+namespace {
+
+    /**
+     * @struct DispatchContext
+     * @brief Обработчик порта и счётчик байт одного вызова pcap_dispatch()
+     */
+    struct DispatchContext {
+        IoPort::FrameHandler handler;
+        void* user;
+        uint64_t bytes;
+    };
+
+} // namespace
+
+PcapPort::PcapPort(std::string name, pcap_t* handle, int txFd)
+    : IoPort(std::move(name)), handle_(handle), txFd_(txFd) {}
+
+PcapPort::~PcapPort() {
+    if (txFd_ >= 0) {
+        close(txFd_);
+    }
+    pcap_close(handle_);
+}
+
+void PcapPort::dispatchHandler(u_char* user, const struct pcap_pkthdr* header, const u_char* packet) {
+    auto* ctx = reinterpret_cast<DispatchContext*>(user);
+    ctx->bytes += header->len;
+    ctx->handler(ctx->user, const_cast<u_char*>(packet), header->caplen, header->len);
+}
+
+int PcapPort::receiveBurst(size_t max, int, FrameHandler handler, void* user) {
+    DispatchContext ctx{handler, user, 0};
+    int count = pcap_dispatch(handle_, int(std::min<size_t>(max, INT_MAX)), dispatchHandler,
+                              reinterpret_cast<u_char*>(&ctx));
+    if (count > 0) {
+        countRx(uint64_t(count), ctx.bytes);
+    }
+    return count < 0 ? -1 : count;
+}
+
+size_t PcapPort::sendBurst(const TxFrame* frames, size_t count) {
+    if (txFd_ >= 0) {
+        return sendToSocket(txFd_, frames, count);
+    }
+    size_t sent = 0, bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (pcap_sendpacket(handle_, frames[i].data, int(frames[i].length)) == 0) {
+            ++sent;
+            bytes += frames[i].length;
+        }
+    }
+    countTx(sent, bytes, count - sent);
+    return sent;
+}
+
+void PcapPort::setNonblocking() {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    if (pcap_setnonblock(handle_, 1, errbuf) != 0) {
+        throw std::runtime_error("pcap_setnonblock failed: " + std::string(errbuf));
+    }
+}
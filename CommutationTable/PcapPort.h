@@ -0,0 +1,52 @@
+#ifndef PCAP_PORT_H
+#define PCAP_PORT_H
+
+#include "IoPort.h"
+
+/**
+ * @class PcapPort
+ * @brief Порт на дескрипторе libpcap (capture_backend = pcap)
+ *
+ * Кадры принимаются через pcap_dispatch() и лежат в буфере libpcap, поэтому
+ * изменять их на месте нельзя. Отправка — через сокет AF_PACKET пачками sendmmsg,
+ * а если сокет открыть не удалось, то по одному кадру через pcap_sendpacket().
+ */
+class PcapPort : public IoPort {
+public:
+    /**
+     * @brief Принимает во владение дескриптор libpcap и сокет отправки
+     * @param name Имя интерфейса
+     * @param handle Активированный дескриптор libpcap
+     * @param txFd Сокет AF_PACKET для отправки, -1 — отправка через libpcap
+     */
+    PcapPort(std::string name, pcap_t* handle, int txFd);
+
+    /**
+     * @brief Закрывает дескриптор libpcap и сокет отправки
+     */
+    ~PcapPort() override;
+
+    /**
+     * @brief Обрабатывает до max кадров одним pcap_dispatch()
+     * @note Время ожидания задаётся при открытии дескриптора (pcap_timeout_ms), timeoutMs не используется
+     */
+    int receiveBurst(size_t max, int timeoutMs, FrameHandler handler, void* user) override;
+    size_t sendBurst(const TxFrame* frames, size_t count) override;
+    bool framesWritable() const override { return false; }
+    int selectableFd() const override { return pcap_get_selectable_fd(handle_); }
+    void setNonblocking() override;
+    std::string lastError() const override { return pcap_geterr(handle_); }
+
+    /**
+     * @brief Дескриптор libpcap
+     */
+    pcap_t* handle() const { return handle_; }
+
+private:
+    static void dispatchHandler(u_char* user, const struct pcap_pkthdr* header, const u_char* packet);
+
+    pcap_t* handle_; ///< Дескриптор libpcap
+    int txFd_;       ///< Сокет отправки, -1 — pcap_sendpacket()
+};
+
+#endif // PCAP_PORT_H
@@ -0,0 +1,144 @@
+#include "PcapReactor.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+PcapReactor::PcapReactor(std::vector<Source> sources, size_t threadCount, int burst)
+    : sources_(std::move(sources)), threadCount_(std::max<size_t>(threadCount, 1)), burst_(std::max(burst, 1)) {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+        throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+    }
+    stopFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stopFd_ < 0) {
+        std::string message = "eventfd failed: " + std::string(strerror(errno));
+        close(epollFd_);
+        throw std::runtime_error(message);
+    }
+
+    auto fail = [this](const std::string &message) {
+        close(stopFd_);
+        close(epollFd_);
+        throw std::runtime_error(message);
+    };
+
+    // Событие остановки без EPOLLONESHOT: его видят все потоки
+    struct epoll_event stopEvent{};
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.u64 = kStopToken;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, stopFd_, &stopEvent) != 0) {
+        fail("epoll_ctl failed: " + std::string(strerror(errno)));
+    }
+
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        try {
+            sources_[i].port->setNonblocking();
+        } catch (const std::runtime_error &e) {
+            fail(e.what());
+        }
+        int fd = sources_[i].port->selectableFd();
+        if (fd < 0) {
+            fail("Port " + sources_[i].port->name() + " has no selectable descriptor");
+        }
+        fds_.push_back(fd);
+        if (!arm(i, EPOLL_CTL_ADD)) {
+            fail("epoll_ctl failed: " + std::string(strerror(errno)));
+        }
+    }
+}
+
+PcapReactor::~PcapReactor() {
+    stop();
+    close(stopFd_);
+    close(epollFd_);
+}
+
+void PcapReactor::start() {
+    for (size_t i = 0; i < threadCount_; ++i) {
+        threads_.emplace_back(&PcapReactor::run, this);
+    }
+}
+
+void PcapReactor::stop() {
+    uint64_t one = 1;
+    if (write(stopFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        std::cerr << "Failed to wake reactor threads: " << strerror(errno) << std::endl;
+    }
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+bool PcapReactor::arm(size_t index, int op) {
+    struct epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = index;
+    return epoll_ctl(epollFd_, op, fds_[index], &event) == 0;
+}
+
+PcapReactor::DrainResult PcapReactor::drain(const Source &source) {
+    // В неблокирующем режиме receiveBurst возвращает 0, когда кадров больше нет
+    for (int i = 0; i < kBurstsPerWakeup; ++i) {
+        int count = source.port->receiveBurst(size_t(burst_), 0, source.handler, source.user);
+        if (count == 0) {
+            return DrainResult::Empty;
+        }
+        if (count < 0) {
+            std::cerr << "Receive on " << source.port->name() << " failed: "
+                      << source.port->lastError() << std::endl;
+            return DrainResult::Failed;
+        }
+    }
+    return DrainResult::Pending;
+}
+
+void PcapReactor::run() {
+    constexpr int kMaxEvents = 16;
+    struct epoll_event events[kMaxEvents];
+    // Порты этого потока, у которых после kBurstsPerWakeup пачек могли остаться кадры.
+    // В epoll они не возвращаются: libpcap может держать у себя часть уже готового
+    // блока, о которой epoll не сообщит, поэтому их дочитывает этот же поток
+    std::vector<size_t> pending;
+    std::vector<size_t> again;
+
+    auto service = [&](size_t index) {
+        switch (drain(sources_[index])) {
+        case DrainResult::Empty:
+            if (!arm(index, EPOLL_CTL_MOD)) {
+                std::cerr << "epoll_ctl failed: " << strerror(errno) << std::endl;
+            }
+            break;
+        case DrainResult::Pending:
+            again.push_back(index);
+            break;
+        case DrainResult::Failed:
+            // После ошибки дескриптор больше не ставится на ожидание
+            break;
+        }
+    };
+
+    for (;;) {
+        // Пока есть недочитанные порты, не ждём: только забираем новые готовые дескрипторы
+        int count = epoll_wait(epollFd_, events, kMaxEvents, pending.empty() ? -1 : 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+            return;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == kStopToken) {
+                return;
+            }
+            service(size_t(events[i].data.u64));
+        }
+        // Недочитанные порты обслуживаются после новых, по очереди
+        for (size_t index : pending) {
+            service(index);
+        }
+        pending.swap(again);
+        again.clear();
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef PCAP_REACTOR_H
+#define PCAP_REACTOR_H
+
+#include "../Headers.h"
+#include "IoPort.h"
+
+/**
+ * @class PcapReactor
+ * @brief Приём с многих дескрипторов libpcap несколькими потоками через один epoll
+ *
+ * Порты (PcapPort) переводятся в неблокирующий режим, их IoPort::selectableFd()
+ * регистрируются в одном наборе epoll. Поток-реактор, получивший готовый дескриптор,
+ * выбирает из него кадры вызовами IoPort::receiveBurst() по burst кадров, но не больше
+ * kBurstsPerWakeup вызовов подряд: занятый порт не задерживает остальные порты потока.
+ * Порт, у которого кадры могли остаться, поток не возвращает в epoll (часть готового
+ * блока libpcap держит у себя, и epoll о ней не сообщит), а обслуживает снова после
+ * других готовых дескрипторов. Дескриптор регистрируется с EPOLLONESHOT, поэтому один
+ * дескриптор в каждый момент обрабатывает не больше одного потока и порядок кадров
+ * порта сохраняется.
+ *
+ * Подходит для многих портов с небольшой нагрузкой: число потоков не зависит
+ * от числа портов, а остановка не ждёт тайм-аута чтения libpcap.
+ */
+class PcapReactor {
+public:
+    /**
+     * @struct Source
+     * @brief Порт и обработчик его кадров
+     */
+    struct Source {
+        IoPort *port;                  ///< Порт ввода-вывода
+        IoPort::FrameHandler handler;  ///< Обработчик для IoPort::receiveBurst()
+        void *user;                    ///< Аргумент обработчика
+    };
+
+    /**
+     * @brief Переводит дескрипторы в неблокирующий режим и регистрирует их в epoll
+     * @param sources Порты и обработчики (порты остаются во владении вызывающего)
+     * @param threadCount Число потоков-реакторов
+     * @param burst Максимум кадров за один вызов IoPort::receiveBurst()
+     * @throws std::runtime_error Если дескриптор не поддерживает ожидание или epoll не создан
+     */
+    PcapReactor(std::vector<Source> sources, size_t threadCount, int burst = 64);
+
+    /**
+     * @brief Останавливает потоки и закрывает epoll
+     */
+    ~PcapReactor();
+
+    PcapReactor(const PcapReactor &) = delete;
+    PcapReactor &operator=(const PcapReactor &) = delete;
+
+    /**
+     * @brief Запускает потоки-реакторы
+     */
+    void start();
+
+    /**
+     * @brief Будит и останавливает потоки-реакторы (не дожидаясь тайм-аутов libpcap)
+     */
+    void stop();
+
+private:
+    /**
+     * @enum DrainResult
+     * @brief Итог выборки кадров порта за одно пробуждение
+     */
+    enum class DrainResult {
+        Empty,    ///< Кадров больше нет, дескриптор можно снова ставить на ожидание
+        Pending,  ///< Выбрано kBurstsPerWakeup пачек, кадры могли остаться
+        Failed,   ///< Ошибка приёма
+    };
+
+    void run();
+    DrainResult drain(const Source &source);
+    bool arm(size_t index, int op);
+
+    /// Наибольшее число вызовов receiveBurst() для одного порта за пробуждение
+    static constexpr int kBurstsPerWakeup = 4;
+
+    /// Метка события остановки в epoll_event::data
+    static constexpr uint64_t kStopToken = UINT64_MAX;
+
+    std::vector<Source> sources_;       ///< Порты и обработчики
+    std::vector<int> fds_;              ///< Их selectable fd
+    size_t threadCount_;                ///< Число потоков-реакторов
+    int burst_;                         ///< Кадров за один receiveBurst()
+    int epollFd_ = -1;                  ///< Набор epoll
+    int stopFd_ = -1;                   ///< eventfd для остановки
+    std::vector<std::thread> threads_;  ///< Потоки-реакторы
+};
+
+#endif // PCAP_REACTOR_H
@@ -0,0 +1,32 @@
+#include "RingPort.h"
+
+RingPort::RingPort(std::string name, std::unique_ptr<PacketRing> ring, int txFd)
+    : IoPort(std::move(name)), ring_(std::move(ring)), txFd_(txFd) {}
+
+RingPort::~RingPort() {
+    if (txFd_ >= 0) {
+        close(txFd_);
+    }
+}
+
+int RingPort::receiveBurst(size_t, int timeoutMs, FrameHandler handler, void* user) {
+    // poll() возвращает число кадров блока вместе с пропущенными исходящими — считаем сами
+    uint64_t count = 0, bytes = 0;
+    ring_->poll(nonblocking_ ? 0 : timeoutMs, [&](u_char* packet, uint32_t caplen, uint32_t len) {
+        ++count;
+        bytes += len;
+        handler(user, packet, caplen, len);
+    });
+    if (count) {
+        countRx(count, bytes);
+    }
+    return int(count);
+}
+
+size_t RingPort::sendBurst(const TxFrame* frames, size_t count) {
+    if (txFd_ < 0) {
+        countTx(0, 0, count);
+        return 0;
+    }
+    return sendToSocket(txFd_, frames, count);
+}
@@ -0,0 +1,46 @@
+#ifndef RING_PORT_H
+#define RING_PORT_H
+
+#include "IoPort.h"
+#include "PacketRing.h"
+
+/**
+ * @class RingPort
+ * @brief Порт на кольце AF_PACKET TPACKET_V3 (capture_backend = tpacket_v3)
+ *
+ * Кадры обрабатываются прямо в блоке кольца: до возврата блока ядру их можно
+ * изменять на месте. Отправка — через сокет AF_PACKET пачками sendmmsg.
+ * При нескольких потоках захвата на порт у каждого своё кольцо и свой RingPort;
+ * сокет отправки нужен только одному из них.
+ */
+class RingPort : public IoPort {
+public:
+    /**
+     * @brief Принимает во владение кольцо и сокет отправки
+     * @param name Имя интерфейса
+     * @param ring Кольцо приёма
+     * @param txFd Сокет AF_PACKET для отправки, -1 — порт только принимает
+     */
+    RingPort(std::string name, std::unique_ptr<PacketRing> ring, int txFd);
+
+    /**
+     * @brief Закрывает сокет отправки (кольцо закрывается деструктором PacketRing)
+     */
+    ~RingPort() override;
+
+    /**
+     * @brief Обрабатывает очередной готовый блок кольца целиком (max не ограничивает блок)
+     */
+    int receiveBurst(size_t max, int timeoutMs, FrameHandler handler, void* user) override;
+    size_t sendBurst(const TxFrame* frames, size_t count) override;
+    bool framesWritable() const override { return true; }
+    int selectableFd() const override { return ring_->fd(); }
+    void setNonblocking() override { nonblocking_ = true; }
+
+private:
+    std::unique_ptr<PacketRing> ring_; ///< Кольцо приёма
+    int txFd_;                         ///< Сокет отправки, -1 — нет
+    bool nonblocking_ = false;         ///< Не ждать готовности блока
+};
+
+#endif // RING_PORT_H
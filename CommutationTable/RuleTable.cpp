@@ -0,0 +1,374 @@
+#include "RuleTable.h"
+#include "NetworkUtils/Checksum.h"
+
+namespace {
+
+    // Раскладка второго слова ключа
+    constexpr unsigned kProtoShift = 48;
+    constexpr unsigned kL4Shift = 40;
+    constexpr unsigned kIcmpShift = 32;
+    constexpr unsigned kSrcPortShift = 16;
+
+    uint32_t prefixMask(unsigned prefix) {
+        return prefix == 0 ? 0 : ~uint32_t(0) << (32 - prefix);
+    }
+
+    [[noreturn]] void fail(const std::string& filename, size_t lineNumber, const std::string& message) {
+        throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": " + message);
+    }
+
+    /**
+     * @brief Разбирает целое число в диапазоне [0, max]
+     * @return Число или -1, если строка не число или вне диапазона
+     */
+    long parseNumber(const std::string& str, long max) {
+        if (str.empty() || !std::all_of(str.begin(), str.end(), ::isdigit) || str.size() > 10) {
+            return -1;
+        }
+        long value = std::stol(str);
+        return value <= max ? value : -1;
+    }
+
+    /**
+     * @brief Разбирает "a.b.c.d" или "a.b.c.d/len"
+     * @return false при ошибке
+     */
+    bool parsePrefix(const std::string& str, uint32_t& address, unsigned& prefix) {
+        size_t slash = str.find('/');
+        long length = 32;
+        if (slash != std::string::npos) {
+            length = parseNumber(str.substr(slash + 1), 32);
+            if (length < 0) {
+                return false;
+            }
+        }
+        struct in_addr addr{};
+        if (inet_pton(AF_INET, str.substr(0, slash).c_str(), &addr) != 1) {
+            return false;
+        }
+        prefix = unsigned(length);
+        address = ntohl(addr.s_addr) & prefixMask(prefix);
+        return true;
+    }
+
+    int parseProto(const std::string& str) {
+        if (str == "icmp") return IPPROTO_ICMP;
+        if (str == "tcp") return IPPROTO_TCP;
+        if (str == "udp") return IPPROTO_UDP;
+        return int(parseNumber(str, 255));
+    }
+
+    /**
+     * @brief Смещение заголовка L3 и его тип: за тегом 802.1Q, если он есть
+     * @return 0, если кадр короче заголовков Ethernet
+     */
+    size_t l3Offset(const u_char* frame, uint32_t length, uint16_t& etherType) {
+        size_t offset = sizeof(struct ether_header);
+        if (length < offset) {
+            return 0;
+        }
+        memcpy(&etherType, frame + offset - 2, sizeof(etherType));
+        if (etherType == htons(ETHERTYPE_VLAN)) {
+            offset += 4;
+            if (length < offset) {
+                return 0;
+            }
+            memcpy(&etherType, frame + offset - 2, sizeof(etherType));
+        }
+        return offset;
+    }
+
+    /**
+     * @brief Адрес заголовка IP и смещение заголовка L4 в кадре, проверенном extractKey()
+     */
+    struct ip* ipHeader(u_char* frame, uint32_t length, size_t& l4Offset) {
+        uint16_t etherType;
+        auto* header = reinterpret_cast<struct ip*>(frame + l3Offset(frame, length, etherType));
+        l4Offset = size_t(reinterpret_cast<u_char*>(header) - frame) + (header->ip_hl << 2);
+        return header;
+    }
+
+} // namespace
+
+void RuleTable::addRule(const Match& match, const RuleAction& action) {
+    Rule rule{};
+    rule.maskA = uint64_t(prefixMask(match.srcPrefix)) << 32 | prefixMask(match.dstPrefix);
+    rule.keyA = (uint64_t(match.src) << 32 | match.dst) & rule.maskA;
+
+    FlowKey fields;
+    if (match.proto >= 0) {
+        fields.proto = uint8_t(match.proto);
+        rule.maskB |= uint64_t(0xFF) << kProtoShift;
+    }
+    if (match.icmpType >= 0) {
+        fields.icmpType = uint8_t(match.icmpType);
+        rule.maskB |= uint64_t(0xFF) << kIcmpShift;
+    }
+    if (match.srcPort >= 0) {
+        fields.srcPort = uint16_t(match.srcPort);
+        rule.maskB |= uint64_t(0xFFFF) << kSrcPortShift;
+    }
+    if (match.dstPort >= 0) {
+        fields.dstPort = uint16_t(match.dstPort);
+        rule.maskB |= 0xFFFF;
+    }
+    // Условия на поля L4 не должны совпадать с нулями фрагментов без заголовка L4
+    if (match.icmpType >= 0 || match.srcPort >= 0 || match.dstPort >= 0) {
+        fields.hasL4 = true;
+        rule.maskB |= uint64_t(1) << kL4Shift;
+    }
+    uint64_t unusedA;
+    packKey(fields, unusedA, rule.keyB);
+    rule.keyB &= rule.maskB;
+
+    rule.action = action;
+    rules_.push_back(rule);
+}
+
+void RuleTable::loadFromFile(const std::string& filename, const std::vector<std::string>& portNames) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open rules file: " + filename);
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream tokens(line);
+        std::string token;
+        Match match;
+        RuleAction action;
+        bool inActions = false;
+        bool hasTokens = false;
+        bool hasActions = false;
+
+        while (tokens >> token) {
+            hasTokens = true;
+            if (token == "->") {
+                if (inActions) {
+                    fail(filename, lineNumber, "duplicate '->'");
+                }
+                inActions = true;
+                continue;
+            }
+
+            size_t eq = token.find('=');
+            std::string key = token.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : token.substr(eq + 1);
+
+            if (inActions) {
+                hasActions = true;
+                if (key == "drop" && eq == std::string::npos) {
+                    action.drop = true;
+                } else if (key == "icmp_type") {
+                    action.icmpType = int(parseNumber(value, 255));
+                    if (action.icmpType < 0) fail(filename, lineNumber, "invalid icmp_type: " + value);
+                } else if (key == "ttl") {
+                    action.ttl = int(parseNumber(value, 255));
+                    if (action.ttl <= 0) fail(filename, lineNumber, "invalid ttl: " + value);
+                } else if (key == "mirror") {
+                    auto it = std::find(portNames.begin(), portNames.end(), value);
+                    if (it == portNames.end()) fail(filename, lineNumber, "unknown mirror port: " + value);
+                    action.mirrorPort = int(it - portNames.begin());
+                } else {
+                    fail(filename, lineNumber, "unknown action: " + token);
+                }
+                continue;
+            }
+
+            if (key == "src" || key == "dst") {
+                bool ok = key == "src" ? parsePrefix(value, match.src, match.srcPrefix)
+                                       : parsePrefix(value, match.dst, match.dstPrefix);
+                if (!ok) fail(filename, lineNumber, "invalid address: " + value);
+            } else if (key == "proto") {
+                match.proto = parseProto(value);
+                if (match.proto < 0) fail(filename, lineNumber, "invalid proto: " + value);
+            } else if (key == "icmp_type") {
+                match.icmpType = int(parseNumber(value, 255));
+                if (match.icmpType < 0) fail(filename, lineNumber, "invalid icmp_type: " + value);
+            } else if (key == "src_port" || key == "dst_port") {
+                int port = int(parseNumber(value, 65535));
+                if (port < 0) fail(filename, lineNumber, "invalid port: " + value);
+                (key == "src_port" ? match.srcPort : match.dstPort) = port;
+            } else {
+                fail(filename, lineNumber, "unknown match field: " + token);
+            }
+        }
+
+        if (!hasTokens) {
+            continue;
+        }
+        if (!hasActions) {
+            fail(filename, lineNumber, "rule has no actions");
+        }
+
+        // Поля L4 имеют смысл только для своего протокола
+        if ((match.icmpType >= 0 || action.icmpType >= 0) && match.proto != IPPROTO_ICMP) {
+            if (match.proto >= 0) fail(filename, lineNumber, "icmp_type requires proto=icmp");
+            match.proto = IPPROTO_ICMP;
+        }
+        if ((match.srcPort >= 0 || match.dstPort >= 0) &&
+            match.proto != IPPROTO_TCP && match.proto != IPPROTO_UDP) {
+            fail(filename, lineNumber, "src_port/dst_port require proto=tcp or proto=udp");
+        }
+        if (action.drop && action.rewrites()) {
+            fail(filename, lineNumber, "drop cannot be combined with rewrite actions");
+        }
+
+        addRule(match, action);
+    }
+}
+
+void RuleTable::compile() {
+    tuples_.clear();
+    shadowed_ = 0;
+
+    // Группируем правила по маске, сохраняя порядок внутри группы
+    std::map<std::pair<uint64_t, uint64_t>, std::vector<uint32_t>> groups;
+    for (uint32_t i = 0; i < rules_.size(); ++i) {
+        groups[{rules_[i].maskA, rules_[i].maskB}].push_back(i);
+    }
+
+    for (const auto& [mask, members] : groups) {
+        Tuple tuple;
+        tuple.maskA = mask.first;
+        tuple.maskB = mask.second;
+        tuple.firstRule = members.front();
+
+        size_t slots = 2;
+        while (slots < members.size() * 2) {
+            slots <<= 1;
+        }
+        tuple.slotMask = slots - 1;
+        tuple.entries.resize(slots);
+
+        for (uint32_t index : members) {
+            const Rule& rule = rules_[index];
+            size_t i = hash(rule.keyA, rule.keyB) & tuple.slotMask;
+            while (tuple.entries[i].rule != kNoRule &&
+                   (tuple.entries[i].a != rule.keyA || tuple.entries[i].b != rule.keyB)) {
+                i = (i + 1) & tuple.slotMask;
+            }
+            if (tuple.entries[i].rule != kNoRule) {
+                ++shadowed_; // То же условие уже задано правилом выше
+                continue;
+            }
+            tuple.entries[i] = {rule.keyA, rule.keyB, index};
+        }
+        tuples_.push_back(std::move(tuple));
+    }
+
+    std::sort(tuples_.begin(), tuples_.end(),
+              [](const Tuple& l, const Tuple& r) { return l.firstRule < r.firstRule; });
+}
+
+const RuleAction* RuleTable::classify(const FlowKey& key) const {
+    uint64_t a, b;
+    packKey(key, a, b);
+
+    uint32_t best = kNoRule;
+    for (const Tuple& tuple : tuples_) {
+        // В этой и следующих группах нет правил раньше уже найденного
+        if (tuple.firstRule >= best) {
+            break;
+        }
+        uint64_t maskedA = a & tuple.maskA;
+        uint64_t maskedB = b & tuple.maskB;
+        for (size_t i = hash(maskedA, maskedB) & tuple.slotMask;; i = (i + 1) & tuple.slotMask) {
+            const Entry& entry = tuple.entries[i];
+            if (entry.rule == kNoRule) {
+                break;
+            }
+            if (entry.a == maskedA && entry.b == maskedB) {
+                best = std::min(best, entry.rule);
+                break;
+            }
+        }
+    }
+    return best == kNoRule ? nullptr : &rules_[best].action;
+}
+
+bool RuleTable::extractKey(const u_char* frame, uint32_t length, FlowKey& key) {
+    // Правила действуют и на кадры с тегом 802.1Q: иначе их обходили бы, добавив тег
+    uint16_t etherType;
+    size_t offset = l3Offset(frame, length, etherType);
+    if (offset == 0 || etherType != htons(ETHERTYPE_IP) || length < offset + sizeof(struct ip)) {
+        return false;
+    }
+
+    const auto* ip = reinterpret_cast<const struct ip*>(frame + offset);
+    size_t l4Offset = offset + (ip->ip_hl << 2);
+    if (ip->ip_v != 4 || ip->ip_hl < 5 || length < l4Offset) {
+        return false;
+    }
+
+    uint32_t address;
+    memcpy(&address, &ip->ip_src, sizeof(address));
+    key.src = ntohl(address);
+    memcpy(&address, &ip->ip_dst, sizeof(address));
+    key.dst = ntohl(address);
+    key.proto = ip->ip_p;
+    key.hasL4 = false;
+    key.icmpType = 0;
+    key.srcPort = 0;
+    key.dstPort = 0;
+
+    // Заголовок L4 есть только в первом фрагменте
+    if ((ntohs(ip->ip_off) & IP_OFFMASK) != 0 || length < l4Offset + 4) {
+        return true;
+    }
+    const u_char* l4 = frame + l4Offset;
+    if (key.proto == IPPROTO_ICMP) {
+        key.icmpType = l4[0];
+        key.hasL4 = true;
+    } else if (key.proto == IPPROTO_TCP || key.proto == IPPROTO_UDP) {
+        key.srcPort = uint16_t(l4[0] << 8 | l4[1]);
+        key.dstPort = uint16_t(l4[2] << 8 | l4[3]);
+        key.hasL4 = true;
+    }
+    return true;
+}
+
+void RuleTable::apply(const RuleAction& action, u_char* frame, uint32_t length) {
+    size_t l4Offset;
+    struct ip* ip = ipHeader(frame, length, l4Offset);
+
+    if (action.ttl >= 0 && ip->ip_ttl != action.ttl) {
+        // TTL делит 16-битное слово с полем протокола
+        uint16_t oldWord, newWord;
+        memcpy(&oldWord, &ip->ip_ttl, sizeof(oldWord));
+        ip->ip_ttl = uint8_t(action.ttl);
+        memcpy(&newWord, &ip->ip_ttl, sizeof(newWord));
+        ip->ip_sum = utils::checksumUpdate(ip->ip_sum, oldWord, newWord);
+    }
+
+    if (action.icmpType >= 0 && ip->ip_p == IPPROTO_ICMP &&
+        (ntohs(ip->ip_off) & IP_OFFMASK) == 0 && length >= l4Offset + 4) {
+        auto* icmp = reinterpret_cast<struct icmp*>(frame + l4Offset);
+        uint16_t oldWord, newWord;
+        memcpy(&oldWord, &icmp->icmp_type, sizeof(oldWord));
+        icmp->icmp_type = uint8_t(action.icmpType);
+        icmp->icmp_code = 0;
+        memcpy(&newWord, &icmp->icmp_type, sizeof(newWord));
+        icmp->icmp_cksum = utils::checksumUpdate(icmp->icmp_cksum, oldWord, newWord);
+    }
+}
+
+void RuleTable::packKey(const FlowKey& key, uint64_t& a, uint64_t& b) {
+    a = uint64_t(key.src) << 32 | key.dst;
+    b = uint64_t(key.proto) << kProtoShift | uint64_t(key.hasL4) << kL4Shift |
+        uint64_t(key.icmpType) << kIcmpShift | uint64_t(key.srcPort) << kSrcPortShift | key.dstPort;
+}
+
+size_t RuleTable::hash(uint64_t a, uint64_t b) {
+    uint64_t h = a * 0x9E3779B97F4A7C15ull ^ b * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 32;
+    h *= 0x94D049BB133111EBull;
+    return size_t(h ^ (h >> 29));
+}
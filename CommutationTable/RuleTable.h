@@ -0,0 +1,182 @@
+#ifndef RULE_TABLE_H
+#define RULE_TABLE_H
+
+#include "../Headers.h"
+
+/**
+ * @struct FlowKey
+ * @brief Поля кадра IPv4, по которым сопоставляются правила
+ */
+struct FlowKey {
+    uint32_t src = 0;      ///< IP-адрес источника (порядок байт хоста)
+    uint32_t dst = 0;      ///< IP-адрес назначения (порядок байт хоста)
+    uint8_t proto = 0;     ///< Протокол IP
+    bool hasL4 = false;    ///< Поля ICMP/TCP/UDP прочитаны (нет у фрагментов, кроме первого)
+    uint8_t icmpType = 0;  ///< Тип ICMP (0 для других протоколов)
+    uint16_t srcPort = 0;  ///< Порт TCP/UDP источника (0 для других протоколов)
+    uint16_t dstPort = 0;  ///< Порт TCP/UDP назначения (0 для других протоколов)
+};
+
+/**
+ * @struct RuleAction
+ * @brief Действия правила над совпавшим кадром
+ */
+struct RuleAction {
+    bool drop = false;     ///< Не пересылать кадр
+    int icmpType = -1;     ///< Новый тип ICMP (код обнуляется), -1 — не менять
+    int ttl = -1;          ///< Новый TTL, -1 — не менять
+    int mirrorPort = -1;   ///< Порт, на который отправляется копия принятого кадра, -1 — нет
+
+    /**
+     * @brief Изменяет ли правило содержимое кадра
+     */
+    bool rewrites() const { return icmpType >= 0 || ttl >= 0; }
+};
+
+/**
+ * @class RuleTable
+ * @brief Таблица правил «совпадение — действие» для кадров IPv4
+ *
+ * Правило задаёт значения полей (префиксы адресов, протокол, тип ICMP, порты)
+ * и действия над кадром. Из совпавших правил выбирается первое по порядку.
+ *
+ * При compile() правила группируются по набору проверяемых полей и длинам
+ * префиксов (пространство кортежей): у правил группы одинаковая маска, поэтому
+ * группа — это хэш-таблица по замаскированному ключу. Поиск делает по одному
+ * обращению к хэш-таблице на группу и не зависит от числа правил. Групп столько,
+ * сколько разных видов правил, и просмотр прекращается, как только в оставшихся
+ * группах не может быть правила раньше уже найденного.
+ *
+ * После compile() таблица только читается и может использоваться из любых потоков.
+ */
+class RuleTable {
+public:
+    /**
+     * @struct Match
+     * @brief Условие правила; поле со значением -1 (или префикс 0) не проверяется
+     */
+    struct Match {
+        uint32_t src = 0;        ///< Префикс адреса источника (порядок байт хоста)
+        unsigned srcPrefix = 0;  ///< Длина префикса источника, 0..32
+        uint32_t dst = 0;        ///< Префикс адреса назначения (порядок байт хоста)
+        unsigned dstPrefix = 0;  ///< Длина префикса назначения, 0..32
+        int proto = -1;          ///< Протокол IP
+        int icmpType = -1;       ///< Тип ICMP (только при proto = ICMP)
+        int srcPort = -1;        ///< Порт источника (только при proto = TCP или UDP)
+        int dstPort = -1;        ///< Порт назначения (только при proto = TCP или UDP)
+    };
+
+    /**
+     * @brief Добавляет правило в конец таблицы (до compile())
+     */
+    void addRule(const Match& match, const RuleAction& action);
+
+    /**
+     * @brief Загружает правила из файла и добавляет их в конец таблицы
+     * @param filename Путь к файлу правил
+     * @param portNames Имена интерфейсов портов (для действия mirror)
+     * @throws std::runtime_error Если файл не открывается или правило записано с ошибкой
+     *
+     * Одна строка — одно правило: условия, "->" и действия, например
+     * "src=10.0.0.0/8 proto=icmp icmp_type=0 -> icmp_type=8 ttl=64 mirror=eth2".
+     */
+    void loadFromFile(const std::string& filename, const std::vector<std::string>& portNames);
+
+    /**
+     * @brief Строит классификатор по добавленным правилам
+     */
+    void compile();
+
+    /**
+     * @brief Находит первое совпавшее правило
+     * @param key Поля кадра
+     * @return Действия правила или nullptr, если ни одно правило не совпало
+     */
+    const RuleAction* classify(const FlowKey& key) const;
+
+    /**
+     * @brief Читает поля кадра Ethernet/IPv4
+     * @param frame Кадр, в том числе с тегом 802.1Q
+     * @param length Длина кадра
+     * @param key Результат
+     * @return false, если кадр не IPv4 или заголовок IP обрезан
+     */
+    static bool extractKey(const u_char* frame, uint32_t length, FlowKey& key);
+
+    /**
+     * @brief Применяет к кадру изменения правила (тип ICMP, TTL)
+     * @param action Действия правила
+     * @param frame Кадр, для которого extractKey() вернул true
+     * @param length Длина кадра
+     *
+     * Заголовок IP ищется так же, как в extractKey(): за тегом 802.1Q, если он есть.
+     * Контрольные суммы IP и ICMP обновляются инкрементально.
+     */
+    static void apply(const RuleAction& action, u_char* frame, uint32_t length);
+
+    /**
+     * @brief Число правил
+     */
+    size_t size() const { return rules_.size(); }
+
+    /**
+     * @brief Нет ни одного правила
+     */
+    bool empty() const { return rules_.empty(); }
+
+    /**
+     * @brief Число групп классификатора (после compile())
+     */
+    size_t tupleCount() const { return tuples_.size(); }
+
+    /**
+     * @brief Число правил, которые никогда не сработают из-за более раннего правила с тем же условием
+     */
+    size_t shadowedCount() const { return shadowed_; }
+
+private:
+    /**
+     * @struct Rule
+     * @brief Правило: условие, упакованное в два 64-битных слова, и действия
+     */
+    struct Rule {
+        uint64_t keyA;      ///< Адреса источника и назначения
+        uint64_t keyB;      ///< Протокол, флаг L4, тип ICMP и порты
+        uint64_t maskA;     ///< Маска keyA
+        uint64_t maskB;     ///< Маска keyB
+        RuleAction action;  ///< Действия
+    };
+
+    /**
+     * @struct Entry
+     * @brief Ячейка хэш-таблицы группы
+     */
+    struct Entry {
+        uint64_t a = 0;
+        uint64_t b = 0;
+        uint32_t rule = kNoRule; ///< Номер правила, kNoRule — пустая ячейка
+    };
+
+    /**
+     * @struct Tuple
+     * @brief Группа правил с одинаковой маской
+     */
+    struct Tuple {
+        uint64_t maskA = 0;
+        uint64_t maskB = 0;
+        uint32_t firstRule = 0;      ///< Наименьший номер правила в группе
+        size_t slotMask = 0;         ///< Число ячеек минус 1
+        std::vector<Entry> entries;  ///< Хэш-таблица с линейным пробированием
+    };
+
+    static constexpr uint32_t kNoRule = UINT32_MAX;
+
+    static void packKey(const FlowKey& key, uint64_t& a, uint64_t& b);
+    static size_t hash(uint64_t a, uint64_t b);
+
+    std::vector<Rule> rules_;    ///< Правила в порядке приоритета
+    std::vector<Tuple> tuples_;  ///< Группы по возрастанию firstRule
+    size_t shadowed_ = 0;        ///< Правил, перекрытых более ранними
+};
+
+#endif // RULE_TABLE_H
@@ -0,0 +1,113 @@
+#include "StatsSegment.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+
+namespace {
+
+    constexpr char kMagic[8] = {'S', 'W', 'S', 'T', 'A', 'T', 'S', '\0'};
+
+} // namespace
+
+StatsSegment::StatsSegment(const std::string& name, const std::vector<std::string>& portNames)
+    : name_(name), size_(segmentSize(uint32_t(portNames.size()))), staging_(size_, 0) {
+    // Сегмент прошлого запуска мог остаться после аварийного завершения
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open " + name_ + " failed: " + std::string(strerror(errno)));
+    }
+    if (ftruncate(fd, off_t(size_)) != 0) {
+        std::string message = "ftruncate " + name_ + " failed: " + std::string(strerror(errno));
+        close(fd);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(message);
+    }
+    map_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        shm_unlink(name_.c_str());
+        throw std::runtime_error("mmap " + name_ + " failed: " + std::string(strerror(errno)));
+    }
+
+    Header& h = *new (staging_.data()) Header{};
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.portCount = uint32_t(portNames.size());
+    h.pid = getpid();
+    for (size_t i = 0; i < portNames.size(); ++i) {
+        memcpy(port(i).name, portNames[i].data(), std::min(portNames[i].size(), size_t(IFNAMSIZ - 1)));
+    }
+    publish();
+}
+
+StatsSegment::~StatsSegment() {
+    if (map_) {
+        munmap(map_, size_);
+        shm_unlink(name_.c_str());
+    }
+}
+
+void StatsSegment::publish() {
+    auto* shared = static_cast<uint8_t*>(map_);
+    auto& seq = reinterpret_cast<Header*>(shared)->seq;
+    uint64_t version = seq.load(std::memory_order_relaxed);
+    seq.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header().updatedAtNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    // Счётчик версий в сегменте не перезаписываем: копируем всё, что за ним
+    constexpr size_t kAfterSeq = offsetof(Header, seq) + sizeof(Header::seq);
+    memcpy(shared, staging_.data(), offsetof(Header, seq));
+    memcpy(shared + kAfterSeq, staging_.data() + kAfterSeq, size_ - kAfterSeq);
+
+    seq.store(version + 2, std::memory_order_release);
+}
+
+bool StatsSegment::read(const std::string& name, std::vector<uint8_t>& out, std::string& error) {
+    int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        error = "shm_open " + name + " failed: " + std::string(strerror(errno));
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header)) {
+        close(fd);
+        error = name + " is not a switch statistics segment";
+        return false;
+    }
+    size_t size = size_t(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        error = "mmap " + name + " failed: " + std::string(strerror(errno));
+        return false;
+    }
+
+    const auto* shared = static_cast<const uint8_t*>(map);
+    const auto* header = reinterpret_cast<const Header*>(shared);
+    bool ok = false;
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+        segmentSize(header->portCount) != size) {
+        error = name + " has an unsupported layout";
+    } else {
+        out.resize(size);
+        // Писатель обновляет сегмент раз в секунду, поэтому повторов почти не бывает
+        for (int attempt = 0; attempt < 1000 && !ok; ++attempt) {
+            uint64_t version = header->seq.load(std::memory_order_acquire);
+            if (version & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            memcpy(out.data(), shared, size);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            ok = header->seq.load(std::memory_order_relaxed) == version;
+        }
+        if (!ok) {
+            error = name + " is being rewritten continuously";
+        }
+    }
+    munmap(map, size);
+    return ok;
+}
@@ -0,0 +1,134 @@
+#ifndef STATS_SEGMENT_H
+#define STATS_SEGMENT_H
+
+#include "../Headers.h"
+#include "LatencyHistogram.h"
+#include "StormControl.h"
+
+/**
+ * @class StatsSegment
+ * @brief Счётчики коммутатора в разделяемой памяти (POSIX shm) для внешних утилит
+ *
+ * Сегмент состоит из заголовка Header и portCount записей Port. Коммутатор
+ * раз в секунду собирает счётчики из таблицы, портов и очередей отправки
+ * в локальный буфер (staging) и копирует его в сегмент под счётчиком версий:
+ * пока идёт копирование, seq нечётный. Читатель (switch_stat) повторяет
+ * чтение, если версия была нечётной или изменилась. Путь пересылки кадров
+ * сегмента не касается.
+ *
+ * Все счётчики накопительные; скорости читатель считает по разности двух
+ * снимков и updatedAtNs (CLOCK_MONOTONIC, общий для процессов).
+ */
+class StatsSegment {
+public:
+    /// Версия раскладки сегмента
+    static constexpr uint32_t kVersion = 6;
+
+    /**
+     * @struct Header
+     * @brief Глобальные счётчики
+     */
+    struct Header {
+        char magic[8];             ///< "SWSTATS\0"
+        uint32_t version;          ///< kVersion
+        uint32_t portCount;        ///< Число записей Port за заголовком
+        std::atomic<uint64_t> seq; ///< Счётчик версий: нечётный во время записи
+        uint64_t updatedAtNs;      ///< Время публикации (CLOCK_MONOTONIC), нс
+        int64_t pid;               ///< Процесс коммутатора
+        uint64_t tableSize;        ///< Записей в таблице коммутации
+        uint64_t tableCapacity;    ///< Ёмкость таблицы
+        uint64_t learned;          ///< Выучено адресов
+        uint64_t moved;            ///< Смен порта адресом
+        uint64_t aged;             ///< Удалено устаревших записей
+        uint64_t evicted;          ///< Вытеснено записей из заполненной таблицы
+        uint64_t learnRejected;    ///< Отказов в обучении
+        uint64_t flowCacheHits;    ///< Попаданий в кэш решений
+        uint64_t flowCacheMisses;  ///< Промахов кэша решений
+        uint64_t arpBindings;      ///< Привязок в кэше ARP
+        uint64_t arpHits;          ///< Запросов ARP, на которые ответил коммутатор
+        uint64_t arpMisses;        ///< Запросов ARP, разосланных во все порты
+    };
+
+    /**
+     * @struct Port
+     * @brief Счётчики порта
+     */
+    struct Port {
+        char name[IFNAMSIZ];       ///< Имя интерфейса
+        uint64_t rxFrames;         ///< Принято кадров
+        uint64_t rxBytes;          ///< Принято байт
+        uint64_t txFrames;         ///< Отправлено кадров
+        uint64_t txBytes;          ///< Отправлено байт
+        uint64_t txErrors;         ///< Ошибок отправки
+        uint64_t txDrops;          ///< Отброшено очередью отправки (tail, head, oversize)
+        uint64_t truncated;        ///< Захвачено не целиком
+        uint64_t dropped;          ///< Отброшено при обработке
+        uint64_t flooded;          ///< Разослано во все порты
+        uint64_t unknownUnicast;   ///< Из них с неизвестным адресом назначения
+        uint64_t stormDropped[kStormClasses]; ///< Отброшено ограничением рассылки (по StormClass)
+        uint64_t multicastForwarded; ///< Групповых кадров, разосланных только членам группы
+        uint64_t echoed;           ///< Отброшено эхо кадров, отправленных в этот порт
+        uint64_t looped;           ///< Отброшено кадров, вернувшихся через петлю
+        uint64_t macEntries;       ///< Адресов порта в таблице коммутации
+        uint64_t learnRejected;    ///< Отказов в обучении на порту
+        uint64_t latencyTotal;     ///< Значений в гистограмме задержек
+        uint64_t latencyMax;       ///< Максимальная задержка, нс
+        uint64_t latency[LatencyHistogram::kBuckets]; ///< Корзины гистограммы задержек
+    };
+
+    /**
+     * @brief Размер сегмента для числа портов
+     */
+    static size_t segmentSize(uint32_t portCount) {
+        return sizeof(Header) + size_t(portCount) * sizeof(Port);
+    }
+
+    /**
+     * @brief Создаёт сегмент (заменяя оставшийся от прошлого запуска)
+     * @param name Имя объекта shm ("/commutation_table")
+     * @param portNames Имена портов по номерам
+     * @throws std::runtime_error при ошибке shm_open/ftruncate/mmap
+     */
+    StatsSegment(const std::string& name, const std::vector<std::string>& portNames);
+
+    /**
+     * @brief Снимает отображение и удаляет объект shm
+     */
+    ~StatsSegment();
+
+    StatsSegment(const StatsSegment&) = delete;
+    StatsSegment& operator=(const StatsSegment&) = delete;
+
+    /**
+     * @brief Глобальные счётчики в локальном буфере
+     */
+    Header& header() { return *reinterpret_cast<Header*>(staging_.data()); }
+
+    /**
+     * @brief Счётчики порта в локальном буфере
+     */
+    Port& port(size_t index) {
+        return reinterpret_cast<Port*>(staging_.data() + sizeof(Header))[index];
+    }
+
+    /**
+     * @brief Копирует локальный буфер в сегмент
+     */
+    void publish();
+
+    /**
+     * @brief Читает согласованную копию сегмента другого процесса
+     * @param name Имя объекта shm
+     * @param out Буфер копии (размер подгоняется под сегмент)
+     * @return false, если сегмента нет или он не того формата (текст в error)
+     */
+    static bool read(const std::string& name, std::vector<uint8_t>& out, std::string& error);
+
+private:
+    std::string name_;                ///< Имя объекта shm
+    void* map_ = nullptr;             ///< Отображение сегмента
+    size_t size_ = 0;                 ///< Размер сегмента
+    std::vector<uint8_t> staging_;    ///< Локальный буфер для сбора счётчиков
+};
+
+#endif // STATS_SEGMENT_H
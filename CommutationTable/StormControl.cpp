@@ -0,0 +1,38 @@
+#include "StormControl.h"
+
+StormLimit parseStormLimit(const std::string& str) {
+    StormLimit limit;
+    if (str.empty() || str == "0") {
+        return limit;
+    }
+    size_t digits = 0;
+    while (digits < str.size() && std::isdigit(static_cast<unsigned char>(str[digits]))) {
+        ++digits;
+    }
+    std::string unit = str.substr(digits);
+    std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+
+    static const std::pair<const char*, std::pair<uint64_t, bool>> kUnits[] = {
+            {"pps", {1, false}}, {"kpps", {1000, false}}, {"mpps", {1000000, false}},
+            {"bps", {1, true}}, {"kbps", {1000, true}}, {"mbps", {1000000, true}}, {"gbps", {1000000000, true}},
+    };
+    for (const auto& u : kUnits) {
+        if (digits > 0 && digits <= 9 && unit == u.first) {
+            limit.rate = std::stoull(str.substr(0, digits)) * u.second.first;
+            limit.bits = u.second.second;
+            return limit;
+        }
+    }
+    throw std::invalid_argument("Invalid storm control limit: " + str);
+}
+
+StormControl::StormControl(size_t ports, uint32_t burstMs)
+    : buckets_(new Bucket[std::max<size_t>(ports, 1) * kStormClasses]),
+      tolerance_(uint64_t(burstMs) * 1000000) {}
+
+void StormControl::setLimit(size_t port, StormClass cls, const StormLimit& limit) {
+    Bucket& bucket = buckets_[port * kStormClasses + size_t(cls)];
+    bucket.bits = limit.bits;
+    bucket.psPerUnit = limit.rate ? std::max<uint64_t>(1, 1000000000000ull / limit.rate) : 0;
+    enabled_ = enabled_ || limit.rate != 0;
+}
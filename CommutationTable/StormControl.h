@@ -0,0 +1,112 @@
+#ifndef STORM_CONTROL_H
+#define STORM_CONTROL_H
+
+#include "../Headers.h"
+
+/**
+ * @enum StormClass
+ * @brief Класс кадров, рассылаемых во все порты
+ */
+enum class StormClass {
+    Broadcast,      ///< Широковещательный адрес назначения
+    Multicast,      ///< Групповой адрес назначения
+    UnknownUnicast  ///< Индивидуальный адрес, которого нет в таблице
+};
+
+/// Число классов StormClass
+constexpr size_t kStormClasses = 3;
+
+/**
+ * @struct StormLimit
+ * @brief Ограничение скорости класса кадров
+ */
+struct StormLimit {
+    uint64_t rate = 0;  ///< Кадров или бит в секунду, 0 — без ограничения
+    bool bits = false;  ///< rate в битах в секунду, иначе в кадрах
+};
+
+/**
+ * @brief Разбирает ограничение вида "1000pps", "20kpps", "10mbps", "1gbps"
+ *
+ * Пустая строка и "0" — без ограничения.
+ * @throws std::invalid_argument Если строка не соответствует формату
+ */
+StormLimit parseStormLimit(const std::string& str);
+
+/**
+ * @class StormControl
+ * @brief Ограничение рассылки во все порты (storm control) по портам приёма и классам кадров
+ *
+ * У каждой пары «порт приёма, класс» своё ведро маркеров, реализованное как
+ * GCRA: в ведре хранится только теоретическое время прихода следующего кадра
+ * (TAT). Кадр проходит, если TAT опережает текущее время не больше чем на
+ * допуск всплеска, и сдвигает TAT на свою «стоимость» — 1/rate секунды
+ * на кадр или 8·длина/rate на байты. Одно атомарное слово на ведро
+ * обновляется CAS-циклом, поэтому потоки захвата одного порта (PACKET_FANOUT)
+ * делят ведро без блокировок.
+ */
+class StormControl {
+public:
+    /**
+     * @brief Создаёт вёдра без ограничений
+     * @param ports Число портов
+     * @param burstMs Допуск всплеска: столько миллисекунд трафика на полной скорости проходит разом
+     */
+    StormControl(size_t ports, uint32_t burstMs);
+
+    StormControl(const StormControl&) = delete;
+    StormControl& operator=(const StormControl&) = delete;
+
+    /**
+     * @brief Задаёт ограничение (до запуска потоков захвата)
+     */
+    void setLimit(size_t port, StormClass cls, const StormLimit& limit);
+
+    /**
+     * @brief Есть ли хоть одно ограничение
+     */
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief Проверяет кадр и списывает его стоимость
+     * @param port Порт приёма
+     * @param cls Класс кадра
+     * @param length Длина кадра, байт
+     * @param nowNs Текущее время (steady_clock), нс
+     * @return false, если кадр нужно отбросить
+     */
+    bool admit(int port, StormClass cls, uint32_t length, uint64_t nowNs) {
+        Bucket& bucket = buckets_[size_t(port) * kStormClasses + size_t(cls)];
+        if (bucket.psPerUnit == 0) {
+            return true;
+        }
+        const uint64_t cost = (bucket.bits ? uint64_t(length) * 8 : 1) * bucket.psPerUnit / 1000;
+        uint64_t tat = bucket.tat.load(std::memory_order_relaxed);
+        for (;;) {
+            uint64_t base = std::max(tat, nowNs);
+            if (base - nowNs > tolerance_) {
+                return false;
+            }
+            if (bucket.tat.compare_exchange_weak(tat, base + cost, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+private:
+    /**
+     * @struct Bucket
+     * @brief Ведро одной пары «порт, класс» (в своей строке кэша)
+     */
+    struct alignas(64) Bucket {
+        std::atomic<uint64_t> tat{0}; ///< Теоретическое время прихода следующего кадра, нс
+        uint64_t psPerUnit = 0;       ///< Пикосекунд на кадр или на бит, 0 — без ограничения
+        bool bits = false;            ///< Стоимость считается по длине кадра
+    };
+
+    std::unique_ptr<Bucket[]> buckets_; ///< Вёдра: порт * kStormClasses + класс
+    uint64_t tolerance_;                ///< Допуск всплеска, нс
+    bool enabled_ = false;              ///< Задано хоть одно ограничение
+};
+
+#endif // STORM_CONTROL_H
@@ -0,0 +1,39 @@
+#ifndef SWITCH_PORT_H
+#define SWITCH_PORT_H
+
+#include "../Headers.h"
+#include "IoPort.h"
+#include "StormControl.h"
+
+/**
+ * @struct IngressStats
+ * @brief Счётчики редких событий обработки кадров порта (в своих строках кэша)
+ *
+ * Кадры, ушедшие в один порт по таблице, не считаются: их число — принятые
+ * порта (IoPort::stats()) минус все счётчики, кроме unknownUnicast, и минус запросы ARP,
+ * на которые ответил коммутатор (ArpCache::hits()). Каждый кадр попадает не
+ * больше чем в один счётчик: flooded и multicastForwarded считают только кадры,
+ * действительно ушедшие в порты, отброшенные ограничением рассылки — только stormDropped.
+ */
+struct alignas(64) IngressStats {
+    std::atomic<uint64_t> truncated{0};      ///< Захвачены не целиком (caplen < len)
+    std::atomic<uint64_t> dropped{0};        ///< Отброшены (источник равен назначению, правило drop, чужой VLAN, группа без портов)
+    std::atomic<uint64_t> flooded{0};        ///< Разосланы во все порты (групповой или неизвестный адрес)
+    std::atomic<uint64_t> unknownUnicast{0}; ///< Из них индивидуальных адресов, не найденных в таблице
+    std::atomic<uint64_t> stormDropped[kStormClasses]{}; ///< Отброшено ограничением рассылки (по StormClass)
+    std::atomic<uint64_t> multicastForwarded{0}; ///< Групповые кадры, разосланные только членам группы (IGMP snooping)
+    std::atomic<uint64_t> echoed{0};         ///< Отброшены: вернулись на порт, в который коммутатор их отправил
+    std::atomic<uint64_t> looped{0};         ///< Отброшены: отправленный кадр вернулся через петлю на другой порт
+};
+
+/**
+ * @struct SwitchPort
+ * @brief Порт коммутатора: интерфейс и его порты ввода-вывода
+ */
+struct SwitchPort {
+    std::string name;                  ///< Имя интерфейса
+    std::vector<std::unique_ptr<IoPort>> io; ///< По одному на поток захвата; кадры отправляются через io[0]
+    std::unique_ptr<IngressStats> ingress = std::make_unique<IngressStats>(); ///< Счётчики приёма
+};
+
+#endif // SWITCH_PORT_H
@@ -0,0 +1,181 @@
+#include "TableSnapshot.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+
+namespace {
+
+    constexpr char kMagic[8] = {'M', 'A', 'C', 'S', 'N', 'A', 'P', '\0'};
+
+    static_assert(sizeof(TableSnapshot::Header) == 40, "snapshot header layout");
+    static_assert(sizeof(TableSnapshot::Entry) == 16, "snapshot entry layout");
+
+    uint64_t unixNow() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    [[noreturn]] void fail(const std::string& message, const std::string& path) {
+        throw std::runtime_error(message + " " + path + ": " + std::string(strerror(errno)));
+    }
+
+    /**
+     * @brief Отображение файла только для чтения, снимается в деструкторе
+     */
+    struct MappedFile {
+        void* data = MAP_FAILED;
+        size_t size = 0;
+
+        ~MappedFile() {
+            if (data != MAP_FAILED) {
+                munmap(data, size);
+            }
+        }
+    };
+
+} // namespace
+
+size_t TableSnapshot::save(const CommutationTable& table, const std::string& path,
+                           const std::vector<std::string>& portNames) {
+    std::vector<CommutationTable::EntryInfo> entries = table.entries();
+
+    Header header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.entrySize = sizeof(Entry);
+    header.savedAt = unixNow();
+    header.portCount = uint32_t(portNames.size());
+    header.lifetime = uint32_t(std::max(table.lifetime(), 0));
+
+    std::vector<char> names(portNames.size() * kPortNameSize, 0);
+    for (size_t i = 0; i < portNames.size(); ++i) {
+        memcpy(&names[i * kPortNameSize], portNames[i].data(), std::min(portNames[i].size(), kPortNameSize - 1));
+    }
+
+    std::vector<Entry> records;
+    records.reserve(entries.size());
+    for (const auto& entry : entries) {
+        if (entry.port >= 0 && size_t(entry.port) < portNames.size()) {
+            records.push_back({entry.mac, uint16_t(entry.port), entry.vlan, entry.ageSec});
+        }
+    }
+    header.entryCount = uint32_t(records.size());
+
+    const std::string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fail("Cannot create MAC table snapshot", tmpPath);
+    }
+    const std::pair<const void*, size_t> parts[] = {
+            {&header, sizeof(header)},
+            {names.data(), names.size()},
+            {records.data(), records.size() * sizeof(Entry)},
+    };
+    for (const auto& part : parts) {
+        const char* p = static_cast<const char*>(part.first);
+        size_t left = part.second;
+        while (left > 0) {
+            ssize_t written = write(fd, p, left);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int error = errno;
+                close(fd);
+                unlink(tmpPath.c_str());
+                errno = error;
+                fail("Cannot write MAC table snapshot", tmpPath);
+            }
+            p += written;
+            left -= size_t(written);
+        }
+    }
+    // Данные должны попасть на диск раньше, чем переименование сделает файл снимком
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        int error = errno;
+        unlink(tmpPath.c_str());
+        errno = error;
+        fail("Cannot flush MAC table snapshot", tmpPath);
+    }
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        unlink(tmpPath.c_str());
+        errno = error;
+        fail("Cannot replace MAC table snapshot", path);
+    }
+    return records.size();
+}
+
+TableSnapshot::LoadResult TableSnapshot::load(CommutationTable& table, const std::string& path,
+                                              const std::vector<std::string>& portNames) {
+    LoadResult result;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return result;
+        }
+        fail("Cannot open MAC table snapshot", path);
+    }
+    result.found = true;
+
+    struct stat st{};
+    MappedFile file;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header)) {
+        file.size = size_t(st.st_size);
+        file.data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    int error = errno;
+    close(fd);
+    if (file.size == 0) {
+        throw std::runtime_error("MAC table snapshot " + path + " is truncated");
+    }
+    if (file.data == MAP_FAILED) {
+        errno = error;
+        fail("Cannot map MAC table snapshot", path);
+    }
+
+    const auto* base = static_cast<const char*>(file.data);
+    const auto* header = reinterpret_cast<const Header*>(base);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(path + " is not a MAC table snapshot");
+    }
+    if (header->version != kVersion || header->entrySize != sizeof(Entry)) {
+        throw std::runtime_error("MAC table snapshot " + path + " has unsupported version " +
+                                 std::to_string(header->version));
+    }
+    const size_t namesSize = size_t(header->portCount) * kPortNameSize;
+    if (file.size != sizeof(Header) + namesSize + size_t(header->entryCount) * sizeof(Entry)) {
+        throw std::runtime_error("MAC table snapshot " + path + " has wrong size");
+    }
+
+    // Индекс порта в снимке -> номер порта сейчас (-1 — порта нет)
+    std::vector<int> portMap(header->portCount, -1);
+    for (uint32_t i = 0; i < header->portCount; ++i) {
+        const char* name = base + sizeof(Header) + i * kPortNameSize;
+        std::string savedName(name, strnlen(name, kPortNameSize));
+        auto it = std::find(portNames.begin(), portNames.end(), savedName);
+        if (it != portNames.end()) {
+            portMap[i] = int(it - portNames.begin());
+        }
+    }
+
+    // Часы могли уйти назад: тогда возраст записей считается по снимку
+    const uint64_t now = unixNow();
+    result.snapshotAge = now > header->savedAt ? now - header->savedAt : 0;
+    const uint64_t lifetime = uint64_t(std::max(table.lifetime(), 0));
+
+    const auto* entries = reinterpret_cast<const Entry*>(base + sizeof(Header) + namesSize);
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+        const Entry& entry = entries[i];
+        uint64_t age = entry.ageSec + result.snapshotAge;
+        if (age >= lifetime) {
+            ++result.expired;
+        } else if (entry.port >= header->portCount || portMap[entry.port] < 0) {
+            ++result.unknownPort;
+        } else if (table.restoreEntry(entry.mac, portMap[entry.port], uint32_t(age), entry.vlan)) {
+            ++result.restored;
+        } else {
+            ++result.skipped;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+#ifndef TABLE_SNAPSHOT_H
+#define TABLE_SNAPSHOT_H
+
+#include "../Headers.h"
+#include "CommutationTable.h"
+
+/**
+ * @class TableSnapshot
+ * @brief Снимок таблицы коммутации в файле для «тёплого» перезапуска
+ *
+ * Формат файла (числа в порядке байтов машины, все поля выровнены):
+ * заголовок Header, затем portCount имён портов по kPortNameSize байт,
+ * затем entryCount записей Entry. Порт записи — индекс в списке имён,
+ * поэтому при загрузке записи переходят на порт с тем же именем, даже
+ * если интерфейсы выбраны в другом порядке. Файл читается через mmap
+ * без разбора: записи используются прямо из отображённой памяти.
+ *
+ * Снимок пишется во временный файл, который затем переименовывается,
+ * так что при сбое на диске остаётся прежний целый снимок.
+ */
+class TableSnapshot {
+public:
+    /// Версия формата
+    static constexpr uint32_t kVersion = 2;
+    /// Длина имени порта в файле (с завершающим нулём)
+    static constexpr size_t kPortNameSize = IFNAMSIZ;
+
+    /**
+     * @struct Header
+     * @brief Заголовок файла снимка (40 байт)
+     */
+    struct Header {
+        char magic[8];       ///< "MACSNAP\0"
+        uint32_t version;    ///< kVersion
+        uint32_t entrySize;  ///< sizeof(Entry): защита от чтения чужой раскладки
+        uint64_t savedAt;    ///< Время записи, секунды Unix
+        uint32_t portCount;  ///< Число имён портов
+        uint32_t entryCount; ///< Число записей
+        uint32_t lifetime;   ///< Время жизни записей при записи, секунды (справочно)
+        uint32_t reserved;   ///< Выравнивание, 0
+    };
+
+    /**
+     * @struct Entry
+     * @brief Запись снимка (16 байт)
+     */
+    struct Entry {
+        uint64_t mac;    ///< MAC-адрес (младшие 48 бит)
+        uint16_t port;   ///< Индекс имени порта
+        uint16_t vlan;   ///< VLAN
+        uint32_t ageSec; ///< Секунд с последней активности на момент savedAt
+    };
+
+    /**
+     * @struct LoadResult
+     * @brief Итог загрузки снимка
+     */
+    struct LoadResult {
+        bool found = false;      ///< Файл снимка существует
+        size_t restored = 0;     ///< Восстановлено записей
+        size_t expired = 0;      ///< Отброшено: старше времени жизни
+        size_t unknownPort = 0;  ///< Отброшено: порта с таким именем нет
+        size_t skipped = 0;      ///< Не добавлено: адрес уже выучен, таблица заполнена или ограничение порта
+        uint64_t snapshotAge = 0; ///< Возраст снимка, секунды
+    };
+
+    /**
+     * @brief Записывает снимок таблицы
+     * @param table Таблица коммутации
+     * @param path Путь к файлу снимка
+     * @param portNames Имена портов по номерам
+     * @return Число записанных записей
+     * @throws std::runtime_error при ошибке ввода-вывода
+     */
+    static size_t save(const CommutationTable& table, const std::string& path,
+                       const std::vector<std::string>& portNames);
+
+    /**
+     * @brief Загружает снимок в таблицу
+     *
+     * Возраст записи увеличивается на время, прошедшее с записи снимка;
+     * записи, возраст которых достиг времени жизни таблицы, отбрасываются.
+     * Отсутствие файла ошибкой не считается (found = false).
+     *
+     * @param table Таблица коммутации
+     * @param path Путь к файлу снимка
+     * @param portNames Имена портов по номерам
+     * @throws std::runtime_error, если файл не читается или повреждён
+     */
+    static LoadResult load(CommutationTable& table, const std::string& path,
+                           const std::vector<std::string>& portNames);
+};
+
+#endif // TABLE_SNAPSHOT_H
@@ -0,0 +1,116 @@
+#include "VlanTable.h"
+
+std::vector<uint16_t> parseVlanList(const std::string& str) {
+    auto parseId = [&str](const std::string& item) {
+        size_t used = 0;
+        int id = -1;
+        try {
+            id = std::stoi(item, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used != item.size() || id < 1 || id > VlanTable::kMaxVlan) {
+            throw std::invalid_argument("Invalid VLAN list: " + str);
+        }
+        return uint16_t(id);
+    };
+
+    std::vector<uint16_t> vlans;
+    std::istringstream items(str);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) {
+            continue;
+        }
+        size_t dash = item.find('-');
+        uint16_t first = parseId(item.substr(0, dash));
+        uint16_t last = dash == std::string::npos ? first : parseId(item.substr(dash + 1));
+        if (last < first) {
+            throw std::invalid_argument("Invalid VLAN list: " + str);
+        }
+        for (uint32_t id = first; id <= last; ++id) {
+            vlans.push_back(uint16_t(id));
+        }
+    }
+    std::sort(vlans.begin(), vlans.end());
+    vlans.erase(std::unique(vlans.begin(), vlans.end()), vlans.end());
+    return vlans;
+}
+
+VlanTable::VlanTable(size_t ports)
+    : ports_(ports),
+      members_(kMaxVlan + 1) {
+    for (auto& config : ports_) {
+        config.allowed.set(config.pvid);
+    }
+    rebuildMembers();
+}
+
+void VlanTable::setAccess(size_t port, uint16_t vlan) {
+    Port& config = ports_[port];
+    config.trunk = false;
+    config.pvid = vlan;
+    config.allowed.reset();
+    config.allowed.set(vlan);
+    rebuildMembers();
+}
+
+void VlanTable::setTrunk(size_t port, uint16_t nativeVlan, const std::vector<uint16_t>& allowed) {
+    Port& config = ports_[port];
+    config.trunk = true;
+    config.pvid = nativeVlan;
+    config.allowed.reset();
+    for (uint16_t vlan : allowed) {
+        config.allowed.set(vlan);
+    }
+    if (nativeVlan != 0) {
+        config.allowed.set(nativeVlan);
+    }
+    rebuildMembers();
+}
+
+void VlanTable::rebuildMembers() {
+    for (auto& ports : members_) {
+        ports.clear();
+    }
+    for (size_t i = 0; i < ports_.size(); ++i) {
+        for (size_t vlan = 1; vlan <= kMaxVlan; ++vlan) {
+            if (ports_[i].allowed[vlan]) {
+                members_[vlan].push_back(int(i));
+            }
+        }
+    }
+}
+
+void VlanTable::print(const std::vector<std::string>& names) const {
+    std::ostringstream out;
+    out << "VLANs:";
+    for (size_t i = 0; i < ports_.size(); ++i) {
+        const Port& config = ports_[i];
+        out << "\n  " << std::left << std::setw(12) << (i < names.size() ? names[i] : std::to_string(i));
+        if (!config.trunk) {
+            out << "access " << config.pvid;
+            continue;
+        }
+        out << "trunk native " << (config.pvid ? std::to_string(config.pvid) : "none") << ", allowed ";
+        // Диапазоны подряд идущих VLAN, как в vlan_allowed
+        bool first = true;
+        for (size_t vlan = 1; vlan <= kMaxVlan; ++vlan) {
+            if (!config.allowed[vlan]) {
+                continue;
+            }
+            size_t last = vlan;
+            while (last < kMaxVlan && config.allowed[last + 1]) {
+                ++last;
+            }
+            out << (first ? "" : ",") << vlan;
+            if (last > vlan) {
+                out << "-" << last;
+            }
+            first = false;
+            vlan = last;
+        }
+    }
+    std::cout << out.str() << std::endl;
+}
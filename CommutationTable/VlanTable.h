@@ -0,0 +1,120 @@
+#ifndef VLAN_TABLE_H
+#define VLAN_TABLE_H
+
+#include "../Headers.h"
+#include <bitset>
+
+/**
+ * @brief Разбирает список VLAN вида "10,20,30-40"
+ * @return Номера VLAN по возрастанию без повторов
+ * @throws std::invalid_argument Если элемент не число или вне диапазона 1–4094
+ */
+std::vector<uint16_t> parseVlanList(const std::string& str);
+
+/**
+ * @class VlanTable
+ * @brief Членство портов во VLAN 802.1Q (access и trunk порты)
+ *
+ * Порт access принадлежит одному VLAN: кадры без тега (и с тегом его VLAN
+ * или приоритетным тегом VLAN 0) попадают в этот VLAN, в порт они уходят без тега.
+ * Порт trunk пропускает кадры с тегами разрешённых VLAN; кадры без тега относятся
+ * к native VLAN и уходят в порт без тега, кадры остальных VLAN — с тегом.
+ *
+ * Таблица заполняется до запуска потоков захвата и потом не меняется, поэтому
+ * классификация кадра и выбор тега на пути пересылки не берут блокировок.
+ */
+class VlanTable {
+public:
+    /// Наибольший номер VLAN (4095 зарезервирован)
+    static constexpr uint16_t kMaxVlan = 4094;
+
+    /**
+     * @brief Создаёт таблицу, в которой все порты — access в VLAN 1
+     * @param ports Число портов
+     */
+    explicit VlanTable(size_t ports);
+
+    /**
+     * @brief Делает порт access
+     * @param vlan VLAN порта
+     */
+    void setAccess(size_t port, uint16_t vlan);
+
+    /**
+     * @brief Делает порт trunk
+     * @param nativeVlan VLAN кадров без тега, 0 — кадры без тега отбрасываются
+     * @param allowed Разрешённые VLAN (native VLAN разрешается всегда)
+     */
+    void setTrunk(size_t port, uint16_t nativeVlan, const std::vector<uint16_t>& allowed);
+
+    /**
+     * @brief Определяет VLAN принятого кадра
+     * @param port Порт приёма
+     * @param frame Кадр Ethernet
+     * @param length Длина кадра
+     * @param vlan VLAN кадра
+     * @param tagged Есть ли у кадра тег 802.1Q
+     * @return false, если порт не принимает кадр (VLAN не разрешён или нет native VLAN)
+     */
+    bool classify(int port, const u_char* frame, int length, uint16_t& vlan, bool& tagged) const {
+        const Port& config = ports_[size_t(port)];
+        const auto* eth = reinterpret_cast<const struct ether_header*>(frame);
+        tagged = eth->ether_type == htons(ETHERTYPE_VLAN);
+        if (!tagged) {
+            vlan = config.pvid;
+            return vlan != 0;
+        }
+        if (length < int(sizeof(struct ether_header)) + 4) {
+            return false;
+        }
+        uint16_t tci;
+        memcpy(&tci, frame + sizeof(struct ether_header), sizeof(tci));
+        vlan = ntohs(tci) & 0x0FFF;
+        // Приоритетный тег (VLAN 0) относится к VLAN порта
+        if (vlan == 0) {
+            vlan = config.pvid;
+        }
+        return vlan != 0 && vlan <= kMaxVlan && config.allowed[vlan];
+    }
+
+    /**
+     * @brief Нужен ли кадру VLAN тег при отправке в порт
+     */
+    bool egressTagged(size_t port, uint16_t vlan) const {
+        return ports_[port].trunk && vlan != ports_[port].pvid;
+    }
+
+    /**
+     * @brief Входит ли порт во VLAN (кадры VLAN можно отправлять в порт)
+     */
+    bool isMember(size_t port, uint16_t vlan) const { return ports_[port].allowed.test(vlan); }
+
+    /**
+     * @brief Порты VLAN по возрастанию (для рассылки)
+     */
+    const std::vector<int>& members(uint16_t vlan) const { return members_[vlan]; }
+
+    /**
+     * @brief Выводит режим и VLAN каждого порта
+     * @param names Имена портов по номерам
+     */
+    void print(const std::vector<std::string>& names) const;
+
+private:
+    /**
+     * @struct Port
+     * @brief Настройки порта
+     */
+    struct Port {
+        bool trunk = false;              ///< trunk, иначе access
+        uint16_t pvid = 1;               ///< VLAN порта access или native VLAN порта trunk (0 — нет)
+        std::bitset<kMaxVlan + 1> allowed; ///< Разрешённые VLAN
+    };
+
+    void rebuildMembers();
+
+    std::vector<Port> ports_;                 ///< Настройки по номерам портов
+    std::vector<std::vector<int>> members_;   ///< Порты каждого VLAN
+};
+
+#endif // VLAN_TABLE_H
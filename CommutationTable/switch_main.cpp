@@ -1,128 +1,253 @@
 #include "CommutationTable.h"
 #include "NetworkUtils/NetworkUtils.h"
+#include "NetworkUtils/PcapCapture.h"
 #include "config_parser.h"
+#include "SwitchPort.h"
+#include "Egress.h"
+#include "RuleTable.h"
+#include "Forwarder.h"
+#include "PcapPort.h"
+#include "RingPort.h"
+#include "PcapReactor.h"
+#include "TableSnapshot.h"
+#include "StatsSegment.h"
+#include "GroupTable.h"
+#include "ArpCache.h"
+#include "VlanTable.h"
+#include "LagTable.h"
+#include "DuplicateFilter.h"
+
+/**
+ * @brief Выводит по портам число принятых кадров, отброшенных и разосланных во все порты
+ *
+ * Mcast — групповые кадры, разосланные только членам группы (IGMP snooping).
+ * Storm — кадры, отброшенные ограничением рассылки: широковещательные/групповые/неизвестные.
+ * Echo/Loop — копии кадров, отправленных коммутатором: эхо своей отправки и вернувшиеся через петлю.
+ * MACs — адресов порта в таблице, Learn rej — отказов в обучении (ограничения порта, заполненная таблица).
+ */
+void printIngressStats(const std::vector<SwitchPort> &ports, const CommutationTable &table) {
+    std::cout << "\n=== Ingress ===\n";
+    std::cout << std::left << std::setw(12) << "Port" << std::right << std::setw(14) << "Received"
+              << std::setw(12) << "Truncated" << std::setw(10) << "Dropped" << std::setw(12) << "Flooded"
+              << std::setw(12) << "Unknown" << std::setw(12) << "Mcast" << std::setw(20) << "Storm B/M/U"
+              << std::setw(12) << "Echo/Loop" << std::setw(8) << "MACs" << std::setw(12) << "Learn rej" << "\n";
+    for (size_t i = 0; i < ports.size(); ++i) {
+        const SwitchPort &port = ports[i];
+        uint64_t received = 0;
+        for (const auto &io: port.io) {
+            received += io->stats().rxFrames;
+        }
+        const IngressStats &stats = *port.ingress;
+        std::cout << std::left << std::setw(12) << port.name << std::right << std::setw(14) << received
+                  << std::setw(12) << stats.truncated.load(std::memory_order_relaxed)
+                  << std::setw(10) << stats.dropped.load(std::memory_order_relaxed)
+                  << std::setw(12) << stats.flooded.load(std::memory_order_relaxed)
+                  << std::setw(12) << stats.unknownUnicast.load(std::memory_order_relaxed)
+                  << std::setw(12) << stats.multicastForwarded.load(std::memory_order_relaxed);
+        std::string storm;
+        for (size_t cls = 0; cls < kStormClasses; ++cls) {
+            if (cls) {
+                storm += '/';
+            }
+            storm += std::to_string(stats.stormDropped[cls].load(std::memory_order_relaxed));
+        }
+        CommutationTable::PortLearnStats learning = table.portLearnStats(int(i));
+        std::string duplicates = std::to_string(stats.echoed.load(std::memory_order_relaxed)) + "/" +
+                                 std::to_string(stats.looped.load(std::memory_order_relaxed));
+        std::cout << std::setw(20) << storm << std::setw(12) << duplicates << std::setw(8) << learning.entries << std::setw(12) << learning.rejected
+                  << "\n";
+    }
+    std::cout << std::endl;
+}
 
-
-static uint16_t checksum(uint16_t *addr, int len) {
-    uint32_t sum = 0;
-    while (len > 1) {
-        sum += *addr++;
-        len -= 2;
+/**
+ * @brief Выводит суммарные попадания и промахи кэшей решений потоков захвата
+ */
+void printFlowCacheStats(const std::vector<std::unique_ptr<FlowCache>> &caches) {
+    if (caches.empty()) {
+        return;
+    }
+    uint64_t hits = 0, misses = 0;
+    for (const auto &cache: caches) {
+        hits += cache->hits();
+        misses += cache->misses();
     }
-    if (len == 1) sum += *(uint8_t *) addr;
-    sum = (sum >> 16) + (sum & 0xFFFF);
-    return (uint16_t) (~sum);
+    uint64_t total = hits + misses;
+    std::cout << "Flow cache: " << hits << " hits, " << misses << " misses";
+    if (total) {
+        std::cout << " (" << std::fixed << std::setprecision(1) << 100.0 * double(hits) / double(total)
+                  << "% hit rate)" << std::defaultfloat;
+    }
+    std::cout << "\n" << std::endl;
 }
 
-bool is_target_icmp_packet(struct ip *ip_header, const ttl_substitution_cfg *ttl_cfg) {
-    // Сравниваем IP-адреса
-    bool src_match = (memcmp(&ip_header->ip_src, &ttl_cfg->client_ip, sizeof(struct in_addr))) == 0;
-    bool dst_match = (memcmp(&ip_header->ip_dst, &ttl_cfg->server_ip, sizeof(struct in_addr))) == 0;
-    std::cout << std::boolalpha << src_match << "  " << dst_match;
-    return (src_match && dst_match);
+/**
+ * @struct SnapshotConfig
+ * @brief Периодическое сохранение таблицы коммутации
+ */
+struct SnapshotConfig {
+    std::string file;                   ///< Файл снимка, пусто — не сохранять
+    int intervalSec = 30;               ///< Период сохранения, секунды
+    std::vector<std::string> portNames; ///< Имена портов по номерам
+};
+
+/**
+ * @brief Сохраняет снимок таблицы, ошибки только выводятся
+ */
+void saveTableSnapshot(const CommutationTable &table, const SnapshotConfig &snapshot) {
+    try {
+        TableSnapshot::save(table, snapshot.file, snapshot.portNames);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+    }
 }
 
+/**
+ * @brief Собирает счётчики таблицы, портов и очередей и публикует их в разделяемой памяти
+ */
+void publishStats(StatsSegment &segment, const CommutationTable &table, const Egress &egress,
+                  const std::vector<SwitchPort> &ports,
+                  const std::vector<std::unique_ptr<FlowCache>> &caches, const ArpCache *arp) {
+    StatsSegment::Header &header = segment.header();
+    CommutationTable::Counters events = table.counters();
+    header.tableSize = table.size();
+    header.tableCapacity = table.capacity();
+    header.learned = events.learned;
+    header.moved = events.moved;
+    header.aged = events.aged;
+    header.evicted = events.evicted;
+    header.learnRejected = events.rejected;
+    header.flowCacheHits = header.flowCacheMisses = 0;
+    for (const auto &cache: caches) {
+        header.flowCacheHits += cache->hits();
+        header.flowCacheMisses += cache->misses();
+    }
+    header.arpBindings = arp ? arp->size() : 0;
+    header.arpHits = arp ? arp->hits() : 0;
+    header.arpMisses = arp ? arp->misses() : 0;
+
+    std::map<int, LatencyHistogram::Snapshot> latency;
+    LatencyHistogram::Snapshot overall;
+    table.latency(latency, overall);
+
+    for (size_t i = 0; i < ports.size(); ++i) {
+        StatsSegment::Port &out = segment.port(i);
+        out.rxFrames = out.rxBytes = 0;
+        for (const auto &io: ports[i].io) {
+            IoPortStats rx = io->stats();
+            out.rxFrames += rx.rxFrames;
+            out.rxBytes += rx.rxBytes;
+        }
+        IoPortStats tx = ports[i].io[0]->stats();
+        out.txFrames = tx.txFrames;
+        out.txBytes = tx.txBytes;
+        EgressPortStats queue = egress.portStats(i);
+        out.txErrors = queue.errors;
+        out.txDrops = queue.tailDrops + queue.headDrops + queue.oversize;
+        const IngressStats &ingress = *ports[i].ingress;
+        out.truncated = ingress.truncated.load(std::memory_order_relaxed);
+        out.dropped = ingress.dropped.load(std::memory_order_relaxed);
+        out.flooded = ingress.flooded.load(std::memory_order_relaxed);
+        out.unknownUnicast = ingress.unknownUnicast.load(std::memory_order_relaxed);
+        out.multicastForwarded = ingress.multicastForwarded.load(std::memory_order_relaxed);
+        out.echoed = ingress.echoed.load(std::memory_order_relaxed);
+        out.looped = ingress.looped.load(std::memory_order_relaxed);
+        CommutationTable::PortLearnStats learning = table.portLearnStats(int(i));
+        out.macEntries = learning.entries;
+        out.learnRejected = learning.rejected;
+        for (size_t cls = 0; cls < kStormClasses; ++cls) {
+            out.stormDropped[cls] = ingress.stormDropped[cls].load(std::memory_order_relaxed);
+        }
+
+        const LatencyHistogram::Snapshot &histogram = latency[int(i)];
+        out.latencyTotal = histogram.total;
+        out.latencyMax = histogram.max;
+        std::copy(histogram.counts.begin(), histogram.counts.end(), out.latency);
+    }
+    segment.publish();
+}
 
-void tableMaintenanceThread(CommutationTable &table, std::atomic<bool> &running) {
+void tableMaintenanceThread(CommutationTable &table, const Egress &egress,
+                            const std::vector<SwitchPort> &ports,
+                            const std::vector<std::unique_ptr<FlowCache>> &caches,
+                            const SnapshotConfig &snapshot,
+                            StatsSegment *statsSegment,
+                            GroupTable *groups,
+                            ArpCache *arp,
+                            LagTable *lags,
+                            std::atomic<bool> &running) {
+    int sinceSnapshot = 0;
     while (running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         table.ageEntries();
+        if (groups) {
+            groups->ageEntries();
+        }
+        if (arp) {
+            arp->ageEntries();
+        }
+        // Упавший канал группы агрегирования исключается из выбора, его потоки уходят в остальные
+        for (size_t i = 0; lags && i < ports.size(); ++i) {
+            if (!lags->isMember(int(i))) {
+                continue;
+            }
+            bool up = utils::isLinkUp(ports[i].name);
+            if (lags->setLinkUp(int(i), up)) {
+                std::cout << "LAG " << lags->groupName(int(i)) << ": " << ports[i].name << (up ? " up" : " down")
+                          << ", " << lags->activeLinks(int(i)) << " active links" << std::endl;
+            }
+        }
+
+        if (statsSegment) {
+            publishStats(*statsSegment, table, egress, ports, caches, arp);
+        }
+
+        if (!snapshot.file.empty() && ++sinceSnapshot >= snapshot.intervalSec) {
+            sinceSnapshot = 0;
+            saveTableSnapshot(table, snapshot);
+        }
 
         // Периодический вывод информации
         static int counter = 0;
         if (++counter % 5 == 0) { // Каждые 5 секунд
             table.printTable();
-            table.printStats();
-        }
-    }
-}
-
-void processPacket(pcap_t *handle, const u_char *packet, int port,
-                   CommutationTable &table, const std::vector<pcap_t *> &handles,
-                   int packetLength, const ttl_substitution_cfg *ttl_cfg) {
-    auto start = std::chrono::high_resolution_clock::now();
-    u_char *modified_packet = nullptr;
-    const u_char *packet_to_send = packet; // По умолчанию отправляем исходный пакет
-
-    struct ether_header *eth_header = (struct ether_header *)packet;
-    table.updateStats(0);
-
-    // Пропускаем пакеты с одинаковыми MAC-адресами источника и назначения
-    if (memcmp(eth_header->ether_shost, eth_header->ether_dhost, 6) == 0) {
-        auto end = std::chrono::high_resolution_clock::now();
-        table.updateStats(std::chrono::duration<double, std::milli>(end - start).count());
-        return;
-    }
-
-    table.updateEntry(eth_header->ether_shost, port);
-
-    // Обработка TTL подмены для ICMP
-    if (ttl_cfg->is_active && ntohs(eth_header->ether_type) == ETHERTYPE_IP) {
-        struct ip *ip_header = (struct ip *)(packet + sizeof(struct ether_header));
-
-        if (ip_header->ip_p == IPPROTO_ICMP && is_target_icmp_packet(ip_header, ttl_cfg)) {
-            struct icmp *icmp_header = (struct icmp *)((u_char *)ip_header + (ip_header->ip_hl << 2));
-
-            if (icmp_header->icmp_type == ICMP_ECHOREPLY) {
-                // Создаем копию пакета для модификации
-                modified_packet = new u_char[packetLength];
-                memcpy(modified_packet, packet, packetLength);
-
-                struct ip *mod_iph = reinterpret_cast<struct ip*>(
-                    modified_packet + sizeof(struct ether_header));
-
-                struct icmp *mod_icmp = reinterpret_cast<struct icmp*>(
-                    reinterpret_cast<uint8_t*>(mod_iph) + (mod_iph->ip_hl << 2));
-
-                // Модифицируем ICMP-заголовок
-                mod_icmp->icmp_type = ICMP_ECHO;
-                mod_icmp->icmp_code = 0;
-                mod_icmp->icmp_cksum = 0;
-                mod_icmp->icmp_cksum = checksum((uint16_t *)mod_icmp,
-                                              ntohs(mod_iph->ip_len) - (mod_iph->ip_hl << 2));
-
-                // Пересчитываем IP checksum
-                mod_iph->ip_sum = 0;
-                mod_iph->ip_sum = checksum((uint16_t *)mod_iph, mod_iph->ip_hl << 2);
-
-                // Указываем, что нужно отправить модифицированный пакет
-                packet_to_send = modified_packet;
+            if (groups) {
+                groups->printTable();
             }
-        }
-    }
-
-    // Отправляем только один пакет (либо исходный, либо модифицированный)
-    int dest_port = table.getPortForMac(eth_header->ether_dhost);
-    if (dest_port != -1 && dest_port < (int)handles.size()) {
-        pcap_sendpacket(handles[dest_port], packet_to_send, packetLength);
-    } else {
-        for (size_t i = 0; i < handles.size(); ++i) {
-            if (i != (size_t)port) {
-                pcap_sendpacket(handles[i], packet_to_send, packetLength);
+            table.printStats();
+            egress.printStats();
+            printIngressStats(ports, table);
+            printFlowCacheStats(caches);
+            if (arp) {
+                arp->printStats();
             }
         }
     }
-
-    // Освобождаем память, если создавали модифицированный пакет
-    if (modified_packet != nullptr) {
-        delete[] modified_packet;
-    }
-
-    auto end = std::chrono::high_resolution_clock::now();
-    table.updateStats(std::chrono::duration<double, std::milli>(end - start).count());
 }
-void captureThread(pcap_t *handle, int port,
+
+/**
+ * @brief Поток захвата: принимает кадры порта пачками и обрабатывает их
+ * @param worker Номер порта ввода-вывода (при workers_per_port > 1 кольца порта делят его кадры)
+ * @param cache Кэш решений этого потока или nullptr
+ * @param features Необязательные функции коммутатора
+ */
+void captureThread(int port,
+                   size_t worker,
                    CommutationTable &table,
-                   const std::vector<pcap_t *> &handles,
+                   const std::vector<SwitchPort> &ports,
+                   Egress &egress,
                    std::atomic<bool> &running,
-                   const ttl_substitution_cfg *ttl_cfg) {
-    struct pcap_pkthdr header;
-    const u_char *packet;
+                   const RuleTable &rules,
+                   FlowCache *cache,
+                   const ForwardingFeatures *features) {
+    constexpr size_t kRxBurst = 256;
+    IoPort &io = *ports[port].io[worker];
+    CaptureContext ctx{port, io.framesWritable(), &table, &egress, &rules, ports[port].ingress.get(), cache, features};
 
     while (running) {
-        packet = pcap_next(handle, &header);
-        if (packet) {
-            processPacket(handle, packet, port, table, handles, header.len, ttl_cfg);
+        if (io.receiveBurst(kRxBurst, 100, forwardFrame, &ctx) < 0) {
+            std::cerr << "Receive on " << io.name() << " failed: " << io.lastError() << std::endl;
+            break;
         }
     }
 }
@@ -133,8 +258,6 @@ int main() {
     std::cout << "Enter max entry lifetime (seconds): ";
     std::cin >> lifetime;
 
-    // Инициализируем таблицу коммутации
-    CommutationTable table(lifetime);
     std::atomic<bool> running{true};
 
     // Получаем список интерфейсов
@@ -147,7 +270,7 @@ int main() {
     // Выбираем интерфейсы для работы
     utils::printInterfaces(interfaces);
     std::vector<std::string> selectedInterfaces;
-    std::vector<pcap_t *> handles;
+    std::vector<SwitchPort> ports;
 
     std::cout << "Enter interface names to use (space separated): ";
     std::string line;
@@ -162,19 +285,127 @@ int main() {
         }
     }
 
+    // Способ захвата: libpcap или кольцо AF_PACKET TPACKET_V3
+    ConfigParser switchConfig("../CommutationTable/switch.cfg");
+    std::string backend = switchConfig.getString("capture_backend", "pcap");
+    if (backend != "pcap" && backend != "tpacket_v3") {
+        std::cerr << "Unknown capture_backend: " << backend << std::endl;
+        return 1;
+    }
+
+    // Инициализируем таблицу коммутации: ёмкость и поведение заполненной таблицы
+    std::string fullPolicy = switchConfig.getString("mac_table_full_policy", "evict_oldest");
+    if (fullPolicy != "evict_oldest" && fullPolicy != "reject") {
+        std::cerr << "Unknown mac_table_full_policy: " << fullPolicy << std::endl;
+        return 1;
+    }
+    CommutationTable table(lifetime, size_t(std::max(1, switchConfig.getInt(
+                                   "mac_table_capacity", int(CommutationTable::kDefaultCapacity)))),
+                           fullPolicy == "reject" ? CommutationTable::FullPolicy::Reject
+                                                  : CommutationTable::FullPolicy::EvictOldest);
+
+    PacketRing::Options ringOptions;
+    ringOptions.blockSize = switchConfig.getInt("ring_block_size", ringOptions.blockSize);
+    ringOptions.blockCount = switchConfig.getInt("ring_block_count", ringOptions.blockCount);
+    ringOptions.frameSize = switchConfig.getInt("ring_frame_size", ringOptions.frameSize);
+    ringOptions.blockTimeoutMs = switchConfig.getInt("ring_block_timeout_ms", ringOptions.blockTimeoutMs);
+
+    // Несколько потоков захвата на порт — только через группу PACKET_FANOUT колец
+    int workersPerPort = std::max(1, switchConfig.getInt("workers_per_port", 1));
+    if (backend == "pcap" && workersPerPort > 1) {
+        std::cerr << "workers_per_port requires capture_backend = tpacket_v3, using 1 worker" << std::endl;
+        workersPerPort = 1;
+    }
+
+    // Приём libpcap: 0 — поток на порт, N > 0 — N потоков-реакторов epoll на все порты
+    int reactorThreads = std::max(0, switchConfig.getInt("pcap_reactor_threads", 0));
+    int reactorBurst = switchConfig.getInt("pcap_reactor_burst", 64);
+    if (backend != "pcap" && reactorThreads > 0) {
+        std::cerr << "pcap_reactor_threads requires capture_backend = pcap, ignoring" << std::endl;
+        reactorThreads = 0;
+    }
+
+    // Дескрипторы libpcap: immediate mode отдаёт кадр сразу, а не по заполнению буфера или тайм-ауту
+    utils::CaptureOptions captureOptions;
+    captureOptions.snaplen = switchConfig.getInt("pcap_snaplen", captureOptions.snaplen);
+    captureOptions.bufferSize = switchConfig.getInt("pcap_buffer_size", captureOptions.bufferSize);
+    captureOptions.immediate = switchConfig.getBool("pcap_immediate", captureOptions.immediate);
+    captureOptions.timeoutMs = switchConfig.getInt("pcap_timeout_ms", captureOptions.timeoutMs);
+    std::string precision = switchConfig.getString("pcap_tstamp_precision", "micro");
+    if (precision != "micro" && precision != "nano") {
+        std::cerr << "Unknown pcap_tstamp_precision: " << precision << std::endl;
+        return 1;
+    }
+    captureOptions.nanoTimestamps = precision == "nano";
+
+    EgressConfig egressConfig;
+    egressConfig.batchSize = switchConfig.getInt("egress_batch_size", egressConfig.batchSize);
+    egressConfig.queueDepth = switchConfig.getInt("tx_queue_depth", egressConfig.queueDepth);
+    egressConfig.frameSize = switchConfig.getInt("tx_queue_frame_size", egressConfig.frameSize);
+    try {
+        egressConfig.dropPolicy = parseDropPolicy(switchConfig.getString("tx_drop_policy", "tail"));
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
     // Открываем выбранные интерфейсы
     char errbuf[PCAP_ERRBUF_SIZE];
     for (const auto &iface: selectedInterfaces) {
-        pcap_t *handle = pcap_open_live(iface.c_str(), BUFSIZ, 1, 1000, errbuf);
-        if (handle) {
-            handles.push_back(handle);
-            std::cout << "Listening on interface " << iface << std::endl;
+        SwitchPort port;
+        port.name = iface;
+        if (backend == "tpacket_v3") {
+            try {
+                PacketRing::Options portRingOptions = ringOptions;
+                if (workersPerPort > 1) {
+                    // Номер группы уникален для порта и (почти наверняка) для процесса
+                    portRingOptions.fanoutGroup = (getpid() * 64 + int(ports.size())) & 0xFFFF;
+                    // Память кольца порта делится между потоками захвата
+                    portRingOptions.blockCount = std::max(2u, ringOptions.blockCount / unsigned(workersPerPort));
+                }
+                std::vector<std::unique_ptr<PacketRing>> rings;
+                for (int worker = 0; worker < workersPerPort; ++worker) {
+                    rings.push_back(std::make_unique<PacketRing>(iface, portRingOptions));
+                }
+                // Отправляет только первый порт ввода-вывода, остальным сокет не нужен
+                int txFd = openTxSocket(iface);
+                if (txFd < 0) {
+                    std::cerr << "Couldn't open TX socket on " << iface << ", port will only receive" << std::endl;
+                }
+                for (size_t worker = 0; worker < rings.size(); ++worker) {
+                    port.io.push_back(std::make_unique<RingPort>(iface, std::move(rings[worker]),
+                                                                 worker == 0 ? txFd : -1));
+                }
+            } catch (const std::exception &e) {
+                std::cerr << "Couldn't open interface " << iface << ": " << e.what() << std::endl;
+                continue;
+            }
         } else {
-            std::cerr << "Couldn't open interface " << iface << ": " << errbuf << std::endl;
+            pcap_t *handle = utils::openCapture(iface, captureOptions, errbuf);
+            if (!handle) {
+                std::cerr << "Couldn't open interface " << iface << ": " << errbuf << std::endl;
+                continue;
+            }
+            // Кадры уходят через отдельный сокет отправки, поэтому захват видел бы их как исходящие
+            if (pcap_setdirection(handle, PCAP_D_IN) != 0) {
+                std::cerr << "Couldn't set capture direction on " << iface << ": "
+                          << pcap_geterr(handle) << ", use dup_filter_window_us to drop echoed frames" << std::endl;
+            }
+            int txFd = openTxSocket(iface);
+            if (txFd < 0) {
+                std::cerr << "Couldn't open TX socket on " << iface << ", sending via libpcap" << std::endl;
+            }
+            port.io.push_back(std::make_unique<PcapPort>(iface, handle, txFd));
+        }
+        ports.push_back(std::move(port));
+        std::cout << "Listening on interface " << iface << " (" << backend;
+        if (workersPerPort > 1) {
+            std::cout << ", " << workersPerPort << " workers";
         }
+        std::cout << ")" << std::endl;
     }
 
-    if (handles.empty()) {
+    if (ports.empty()) {
         std::cerr << "No valid interfaces to listen on!" << std::endl;
         return 1;
     }
@@ -204,18 +435,281 @@ int main() {
     std::cout << "TTL substitution config loaded: "
               << "\n  Enabled: " << ttl_cfg.is_active
               << "\n  Client IP: " << client_ip
-              << "\n  Server IP: " << server_ip;
+              << "\n  Server IP: " << server_ip << std::endl;
+
+    // Подмена из ttl_substitution.cfg — первое правило, дальше правила из rules_file
+    RuleTable rules;
+    if (ttl_cfg.is_active) {
+        RuleTable::Match match;
+        match.src = ntohl(ttl_cfg.client_ip.s_addr);
+        match.srcPrefix = 32;
+        match.dst = ntohl(ttl_cfg.server_ip.s_addr);
+        match.dstPrefix = 32;
+        match.proto = IPPROTO_ICMP;
+        match.icmpType = ICMP_ECHOREPLY;
+        RuleAction action;
+        action.icmpType = ICMP_ECHO;
+        rules.addRule(match, action);
+    }
+
+    std::string rulesFile = switchConfig.getString("rules_file", "");
+    if (!rulesFile.empty()) {
+        std::vector<std::string> portNames;
+        for (const auto &p: ports) {
+            portNames.push_back(p.name);
+        }
+        try {
+            rules.loadFromFile(rulesFile, portNames);
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    rules.compile();
+    std::cout << "Rules loaded: " << rules.size() << " in " << rules.tupleCount() << " groups";
+    if (rules.shadowedCount()) {
+        std::cout << " (" << rules.shadowedCount() << " shadowed by earlier rules)";
+    }
+    std::cout << std::endl;
+
+    // Снимок таблицы для тёплого старта загружается позже, после настройки ограничений обучения
+    SnapshotConfig snapshot;
+    snapshot.file = switchConfig.getString("mac_snapshot_file", "");
+    snapshot.intervalSec = std::max(1, switchConfig.getInt("mac_snapshot_interval", snapshot.intervalSec));
+    for (const auto &p: ports) {
+        snapshot.portNames.push_back(p.name);
+    }
+
+    Egress egress(ports, egressConfig);
+
+    // Счётчики для switch_stat публикует поток обслуживания таблицы раз в секунду
+    std::unique_ptr<StatsSegment> statsSegment;
+    std::string statsShmName = switchConfig.getString("stats_shm_name", "");
+    if (!statsShmName.empty()) {
+        try {
+            statsSegment = std::make_unique<StatsSegment>(statsShmName, snapshot.portNames);
+            std::cout << "Statistics published in shared memory " << statsShmName << std::endl;
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << ", statistics are only printed" << std::endl;
+        }
+    }
+
+    // Ограничение рассылки во все порты: общие значения и значения для отдельного порта (ключ.имя)
+    std::unique_ptr<StormControl> stormControl =
+            std::make_unique<StormControl>(ports.size(), uint32_t(std::max(1, switchConfig.getInt("storm_burst_ms", 100))));
+    const std::pair<const char *, StormClass> stormKeys[] = {
+            {"storm_broadcast", StormClass::Broadcast},
+            {"storm_multicast", StormClass::Multicast},
+            {"storm_unknown_unicast", StormClass::UnknownUnicast},
+    };
+    try {
+        for (const auto &key: stormKeys) {
+            std::string common = switchConfig.getString(key.first, "");
+            for (size_t i = 0; i < ports.size(); ++i) {
+                std::string value = switchConfig.getString(std::string(key.first) + "." + ports[i].name, common);
+                stormControl->setLimit(i, key.second, parseStormLimit(value));
+            }
+        }
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (!stormControl->enabled()) {
+        stormControl.reset();
+    }
+
+    // VLAN 802.1Q: режим и VLAN каждого порта (ключ.имя), по умолчанию access в VLAN 1
+    std::unique_ptr<VlanTable> vlanTable;
+    if (switchConfig.getBool("vlan_aware", false)) {
+        vlanTable = std::make_unique<VlanTable>(ports.size());
+        auto parseVlan = [](const std::string &value, int min) {
+            std::vector<uint16_t> list = value == "0" ? std::vector<uint16_t>{} : parseVlanList(value);
+            if ((list.empty() && min > 0) || list.size() > 1) {
+                throw std::invalid_argument("Invalid VLAN: " + value);
+            }
+            return list.empty() ? uint16_t(0) : list[0];
+        };
+        try {
+            for (size_t i = 0; i < ports.size(); ++i) {
+                const std::string &name = ports[i].name;
+                std::string mode = switchConfig.getString("vlan_mode." + name, "access");
+                if (mode == "access") {
+                    vlanTable->setAccess(i, parseVlan(switchConfig.getString("vlan_access." + name, "1"), 1));
+                } else if (mode == "trunk") {
+                    vlanTable->setTrunk(i, parseVlan(switchConfig.getString("vlan_native." + name, "1"), 0),
+                                        parseVlanList(switchConfig.getString("vlan_allowed." + name, "1-4094")));
+                } else {
+                    throw std::invalid_argument("Unknown VLAN mode of " + name + ": " + mode);
+                }
+            }
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        vlanTable->print(snapshot.portNames);
+    }
+
+    // Агрегирование каналов: группы портов, работающие как один логический порт
+    std::unique_ptr<LagTable> lagTable;
+    std::string lagGroups = switchConfig.getString("lag_groups", "");
+    if (!lagGroups.empty()) {
+        try {
+            lagTable = std::make_unique<LagTable>(
+                    ports.size(), parseLagHashPolicy(switchConfig.getString("lag_hash_policy", "layer2+3")));
+            for (auto &group: parseLagGroups(lagGroups, snapshot.portNames)) {
+                lagTable->addGroup(group.first, std::move(group.second));
+            }
+        } catch (const std::invalid_argument &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        if (lagTable->empty()) {
+            lagTable.reset();
+        } else {
+            lagTable->print(snapshot.portNames);
+        }
+    }
+
+    // Ограничения обучения MAC-адресов: общие значения и значения для отдельного порта (ключ.имя).
+    // Адреса группы агрегирования учитываются на её логическом порту: действуют его ограничения
+    int learnLimit = switchConfig.getInt("mac_learn_limit", 0);
+    int learnRate = switchConfig.getInt("mac_learn_rate", 0);
+    for (size_t i = 0; i < ports.size(); ++i) {
+        const std::string &name = ports[i].name;
+        if (lagTable && lagTable->logical(int(i)) != int(i)) {
+            for (const char *key: {"mac_learn_limit.", "mac_learn_rate."}) {
+                if (!switchConfig.getString(key + name, "").empty()) {
+                    std::cerr << "Warning: " << key << name << " is ignored, addresses of LAG "
+                              << lagTable->groupName(int(i)) << " are learned on "
+                              << ports[size_t(lagTable->logical(int(i)))].name << std::endl;
+                }
+            }
+        }
+        CommutationTable::LearnLimits limits;
+        limits.maxEntries = uint32_t(std::max(0, switchConfig.getInt("mac_learn_limit." + name, learnLimit)));
+        limits.perSecond = uint32_t(std::max(0, switchConfig.getInt("mac_learn_rate." + name, learnRate)));
+        table.setLearnLimits(int(i), limits);
+    }
 
+    // Тёплый старт: записи прошлого запуска, ещё не устаревшие, сразу доступны для пересылки.
+    // Загружается после ограничений обучения: восстановленные записи их не превышают
+    if (!snapshot.file.empty()) {
+        try {
+            TableSnapshot::LoadResult loaded = TableSnapshot::load(table, snapshot.file, snapshot.portNames);
+            if (loaded.found) {
+                std::cout << "MAC table snapshot " << snapshot.file << " (" << loaded.snapshotAge << " s old): "
+                          << loaded.restored << " restored, " << loaded.expired << " expired, "
+                          << loaded.unknownPort << " on missing ports, " << loaded.skipped
+                          << " skipped (already learned, table full or port limit)" << std::endl;
+            }
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << ", starting with an empty MAC table" << std::endl;
+        }
+    }
+
+    // IGMP snooping: маска портов группы — 64 бита
+    std::unique_ptr<GroupTable> groupTable;
+    if (switchConfig.getBool("igmp_snooping", false)) {
+        if (ports.size() > GroupTable::kMaxPorts) {
+            std::cerr << "IGMP snooping supports up to " << GroupTable::kMaxPorts
+                      << " ports, multicast is flooded" << std::endl;
+        } else {
+            GroupTable::Options groupOptions;
+            groupOptions.capacity = size_t(std::max(1, switchConfig.getInt("igmp_max_groups", int(groupOptions.capacity))));
+            groupOptions.membershipTimeoutSec = uint32_t(std::max(1, switchConfig.getInt(
+                    "igmp_membership_timeout", int(groupOptions.membershipTimeoutSec))));
+            groupOptions.querierTimeoutSec = uint32_t(std::max(1, switchConfig.getInt(
+                    "igmp_querier_timeout", int(groupOptions.querierTimeoutSec))));
+            groupOptions.leaveTimeoutSec = uint32_t(std::max(1, switchConfig.getInt(
+                    "igmp_leave_timeout", int(groupOptions.leaveTimeoutSec))));
+            groupOptions.floodUnregistered = switchConfig.getBool("igmp_flood_unregistered", false);
+            groupTable = std::make_unique<GroupTable>(ports.size(), groupOptions);
+            std::cout << "IGMP snooping enabled, up to " << groupOptions.capacity << " groups" << std::endl;
+        }
+    }
 
-    // Только после сбора всех данных запускаем служебные потоки
-    std::thread tableThread(tableMaintenanceThread, std::ref(table), std::ref(running));
+    // Подавление запросов ARP: коммутатор сам отвечает на запросы об известных адресах
+    std::unique_ptr<ArpCache> arpCache;
+    if (switchConfig.getBool("arp_suppression", false)) {
+        arpCache = std::make_unique<ArpCache>(size_t(std::max(1, switchConfig.getInt("arp_cache_size", 4096))),
+                                              uint32_t(std::max(1, switchConfig.getInt("arp_cache_timeout", 300))));
+        std::cout << "ARP suppression enabled" << std::endl;
+    }
+
+    // Фильтр копий отправленных кадров: эхо своей отправки и петли L2
+    std::unique_ptr<DuplicateFilter> duplicateFilter;
+    int duplicateWindowUs = std::max(0, switchConfig.getInt("dup_filter_window_us", 0));
+    if (duplicateWindowUs > 0) {
+        duplicateFilter = std::make_unique<DuplicateFilter>(
+                size_t(std::max(1, switchConfig.getInt("dup_filter_size", 65536))), uint32_t(duplicateWindowUs));
+        std::cout << "Duplicate filter enabled, window " << duplicateWindowUs << " us" << std::endl;
+    }
+
+    ForwardingFeatures features;
+    features.storm = stormControl.get();
+    features.groups = groupTable.get();
+    features.arp = arpCache.get();
+    features.vlans = vlanTable.get();
+    features.lags = lagTable.get();
+    features.duplicates = duplicateFilter.get();
+
+    // Кэш решений у каждого потока захвата (в режиме реактора — у каждого порта:
+    // EPOLLONESHOT не даёт двум реакторам обрабатывать порт одновременно)
+    int flowCacheSize = std::max(0, switchConfig.getInt("flow_cache_size", 1024));
+    std::vector<std::unique_ptr<FlowCache>> flowCaches;
+    auto newFlowCache = [&]() -> FlowCache * {
+        if (flowCacheSize == 0) {
+            return nullptr;
+        }
+        flowCaches.push_back(std::make_unique<FlowCache>(size_t(flowCacheSize)));
+        return flowCaches.back().get();
+    };
+
+    // В режиме реактора все дескрипторы libpcap обслуживает общий набор epoll
+    std::vector<CaptureContext> reactorContexts;
+    std::unique_ptr<PcapReactor> reactor;
+    if (reactorThreads > 0) {
+        reactorContexts.reserve(ports.size());
+        std::vector<PcapReactor::Source> sources;
+        for (size_t i = 0; i < ports.size(); ++i) {
+            IoPort &io = *ports[i].io[0];
+            reactorContexts.push_back({int(i), io.framesWritable(), &table, &egress, &rules, ports[i].ingress.get(),
+                                       newFlowCache(), &features});
+            sources.push_back({&io, forwardFrame, &reactorContexts.back()});
+        }
+        try {
+            reactor = std::make_unique<PcapReactor>(std::move(sources), size_t(reactorThreads), reactorBurst);
+        } catch (const std::runtime_error &e) {
+            std::cerr << "Couldn't start capture reactor: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Capture reactor: " << reactorThreads << " thread(s) for " << ports.size() << " ports" << std::endl;
+    }
+
+    std::vector<FlowCache *> workerCaches;
+    for (size_t i = 0; i < ports.size() && !reactor; ++i) {
+        for (size_t worker = 0; worker < ports[i].io.size(); ++worker) {
+            workerCaches.push_back(newFlowCache());
+        }
+    }
+
+    // Только после сбора всех данных запускаем служебные потоки и потоки отправки
+    egress.start();
+    std::thread tableThread(tableMaintenanceThread, std::ref(table), std::cref(egress), std::cref(ports),
+                            std::cref(flowCaches), std::cref(snapshot), statsSegment.get(),
+                            groupTable.get(), arpCache.get(), lagTable.get(), std::ref(running));
 
     // Запускаем потоки захвата для каждого интерфейса
     std::vector<std::thread> captureThreads;
-    for (size_t i = 0; i < handles.size(); ++i) {
-        captureThreads.emplace_back(captureThread, handles[i], i,
-                                    std::ref(table), std::ref(handles),
-                                    std::ref(running), &ttl_cfg);
+    if (reactor) {
+        reactor->start();
+    }
+    for (size_t i = 0, next = 0; i < ports.size() && !reactor; ++i) {
+        for (size_t worker = 0; worker < ports[i].io.size(); ++worker) {
+            captureThreads.emplace_back(captureThread, i, worker, std::ref(table), std::cref(ports),
+                                        std::ref(egress), std::ref(running), std::cref(rules),
+                                        workerCaches[next++], &features);
+        }
     }
 
     // Ожидаем завершения
@@ -226,17 +720,20 @@ int main() {
     running = false;
 
     // Останавливаем потоки захвата
+    if (reactor) {
+        reactor->stop();
+    }
     for (auto &thread: captureThreads) {
         thread.join();
     }
 
-    // Останавливаем поток обслуживания таблицы
+    // Останавливаем поток обслуживания таблицы и потоки отправки
     tableThread.join();
-
-    // Закрываем интерфейсы
-    for (auto handle: handles) {
-        pcap_close(handle);
+    egress.stop();
+    if (!snapshot.file.empty()) {
+        saveTableSnapshot(table, snapshot);
     }
 
+    // Интерфейсы закрываются деструкторами портов ввода-вывода
     return 0;
 }
@@ -0,0 +1,142 @@
+#include "StatsSegment.h"
+
+/**
+ * @brief Утилита просмотра счётчиков работающего коммутатора
+ *
+ * Читает сегмент разделяемой памяти, который публикует Commutation_table
+ * (stats_shm_name в switch.cfg), и выводит скорости за интервал по разности
+ * двух снимков: кадры/с и Мбит/с приёма и отправки, рассылки во все порты
+ * и только членам групп IGMP,
+ * число адресов порта в таблице и отказы в их обучении,
+ * отбрасывания (в том числе ограничением рассылки, эхо и петли) и перцентили задержки
+ * обработки за интервал. Коммутатор при этом не останавливается и не блокируется.
+ *
+ * Запуск: switch_stat [-n имя_shm] [-i секунд] [-c число_выводов]
+ *   -c 0 (по умолчанию) — выводить, пока не прервут
+ */
+
+namespace {
+
+    const StatsSegment::Header& headerOf(const std::vector<uint8_t>& segment) {
+        return *reinterpret_cast<const StatsSegment::Header*>(segment.data());
+    }
+
+    const StatsSegment::Port& portOf(const std::vector<uint8_t>& segment, size_t index) {
+        return reinterpret_cast<const StatsSegment::Port*>(segment.data() + sizeof(StatsSegment::Header))[index];
+    }
+
+    void printInterval(const std::vector<uint8_t>& prev, const std::vector<uint8_t>& cur) {
+        const StatsSegment::Header& a = headerOf(prev);
+        const StatsSegment::Header& b = headerOf(cur);
+        double seconds = double(b.updatedAtNs - a.updatedAtNs) / 1e9;
+        auto rate = [seconds](uint64_t from, uint64_t to) {
+            return seconds > 0 && to >= from ? double(to - from) / seconds : 0.0;
+        };
+        uint64_t lookups = (b.flowCacheHits - a.flowCacheHits) + (b.flowCacheMisses - a.flowCacheMisses);
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1)
+            << "\n=== pid " << b.pid << ", " << seconds << " s: MAC table " << b.tableSize << "/" << b.tableCapacity
+            << ", learned " << b.learned - a.learned << ", moved " << b.moved - a.moved
+            << ", aged " << b.aged - a.aged;
+        if (b.evicted != a.evicted || b.learnRejected != a.learnRejected) {
+            out << ", evicted " << b.evicted - a.evicted << ", learn rejected " << b.learnRejected - a.learnRejected;
+        }
+        if (lookups) {
+            out << ", flow cache hits " << 100.0 * double(b.flowCacheHits - a.flowCacheHits) / double(lookups) << "%";
+        }
+        uint64_t arpRequests = (b.arpHits - a.arpHits) + (b.arpMisses - a.arpMisses);
+        if (arpRequests) {
+            out << ", ARP answered " << 100.0 * double(b.arpHits - a.arpHits) / double(arpRequests) << "%";
+        }
+        out << " ===\n"
+            << std::left << std::setw(12) << "Port" << std::right
+            << std::setw(11) << "RX pps" << std::setw(10) << "RX Mb/s"
+            << std::setw(11) << "TX pps" << std::setw(10) << "TX Mb/s"
+            << std::setw(10) << "Flood/s" << std::setw(10) << "Mcast/s" << std::setw(10) << "Drop/s" << std::setw(10) << "TXdrop/s"
+            << std::setw(10) << "Storm/s" << std::setw(9) << "Echo/s" << std::setw(9) << "Loop/s" << std::setw(8) << "MACs" << std::setw(10) << "LrnRej/s" << std::setw(9) << "p50 us" << std::setw(9) << "p99 us" << std::setw(9) << "max us" << "\n";
+
+        for (uint32_t i = 0; i < b.portCount; ++i) {
+            const StatsSegment::Port& p = portOf(prev, i);
+            const StatsSegment::Port& q = portOf(cur, i);
+            // Гистограмма за интервал — разность корзин двух снимков. Максимум за интервал —
+            // верхняя граница старшей непустой корзины (точность та же, что у перцентилей),
+            // но не больше максимума за всё время
+            LatencyHistogram::Snapshot latency;
+            for (size_t k = 0; k < LatencyHistogram::kBuckets; ++k) {
+                latency.counts[k] = q.latency[k] - p.latency[k];
+                if (latency.counts[k]) {
+                    latency.max = std::min(LatencyHistogram::bucketUpperBound(k), q.latencyMax);
+                }
+            }
+            latency.total = q.latencyTotal - p.latencyTotal;
+
+            out << std::left << std::setw(12) << std::string(q.name, strnlen(q.name, IFNAMSIZ)) << std::right
+                << std::setprecision(0)
+                << std::setw(11) << rate(p.rxFrames, q.rxFrames)
+                << std::setprecision(1)
+                << std::setw(10) << rate(p.rxBytes, q.rxBytes) * 8 / 1e6
+                << std::setprecision(0)
+                << std::setw(11) << rate(p.txFrames, q.txFrames)
+                << std::setprecision(1)
+                << std::setw(10) << rate(p.txBytes, q.txBytes) * 8 / 1e6
+                << std::setprecision(0)
+                << std::setw(10) << rate(p.flooded, q.flooded)
+                << std::setw(10) << rate(p.multicastForwarded, q.multicastForwarded)
+                << std::setw(10) << rate(p.dropped + p.truncated, q.dropped + q.truncated)
+                << std::setw(10) << rate(p.txDrops + p.txErrors, q.txDrops + q.txErrors)
+                << std::setw(10) << rate(p.stormDropped[0] + p.stormDropped[1] + p.stormDropped[2],
+                                         q.stormDropped[0] + q.stormDropped[1] + q.stormDropped[2])
+                << std::setw(9) << rate(p.echoed, q.echoed)
+                << std::setw(9) << rate(p.looped, q.looped)
+                << std::setw(8) << q.macEntries
+                << std::setw(10) << rate(p.learnRejected, q.learnRejected)
+                << std::setprecision(2)
+                << std::setw(9) << double(latency.percentile(50)) / 1000.0
+                << std::setw(9) << double(latency.percentile(99)) / 1000.0
+                << std::setw(9) << double(latency.max) / 1000.0 << "\n";
+        }
+        std::cout << out.str() << std::flush;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string name = "/commutation_table";
+    int interval = 1;
+    long count = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:i:c:")) != -1) {
+        switch (option) {
+            case 'n': name = optarg; break;
+            case 'i': interval = std::max(1, std::stoi(optarg)); break;
+            case 'c': count = std::stol(optarg); break;
+            default:
+                std::cerr << "Usage: switch_stat [-n shm_name] [-i seconds] [-c count]" << std::endl;
+                return 1;
+        }
+    }
+
+    std::vector<uint8_t> prev, cur;
+    std::string error;
+    if (!StatsSegment::read(name, prev, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    for (long printed = 0; count == 0 || printed < count; ++printed) {
+        std::this_thread::sleep_for(std::chrono::seconds(interval));
+        if (!StatsSegment::read(name, cur, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        // Коммутатор перезапущен: число портов или процесс другие, начинаем заново
+        if (headerOf(cur).pid != headerOf(prev).pid || headerOf(cur).portCount != headerOf(prev).portCount) {
+            prev.swap(cur);
+            continue;
+        }
+        printInterval(prev, cur);
+        prev.swap(cur);
+    }
+    return 0;
+}
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <filesystem>
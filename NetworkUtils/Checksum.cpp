@@ -0,0 +1,234 @@
+#include "Checksum.h"
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_X86 1
+#endif
+
+namespace utils {
+
+    namespace {
+
+        /// Сворачивает 64-битный аккумулятор до 16 бит с переносами по кругу
+        uint32_t fold(uint64_t acc) {
+            acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+            acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+            acc = (acc & 0xFFFF) + (acc >> 16);
+            acc = (acc & 0xFFFF) + (acc >> 16);
+            return static_cast<uint32_t>(acc);
+        }
+
+        /**
+         * @brief Скалярное суммирование блока в 64-битный аккумулятор
+         *
+         * Сумма 32-битных слов, свёрнутая до 16 бит, равна сумме 16-битных слов
+         * в обратном коде, поэтому читаем по 4 байта. Переполнение 64-битного
+         * аккумулятора возможно только после 2^32 слов.
+         */
+        uint64_t sumScalar(const uint8_t* p, size_t length, uint64_t acc) {
+            while (length >= 8) {
+                uint32_t w[2];
+                memcpy(w, p, 8);
+                acc += uint64_t(w[0]) + w[1];
+                p += 8;
+                length -= 8;
+            }
+            if (length >= 4) {
+                uint32_t w;
+                memcpy(&w, p, 4);
+                acc += w;
+                p += 4;
+                length -= 4;
+            }
+            if (length >= 2) {
+                uint16_t w;
+                memcpy(&w, p, 2);
+                acc += w;
+                p += 2;
+                length -= 2;
+            }
+            if (length) {
+                // Нечётный байт — старший байт последнего слова в сетевом порядке:
+                // собираем слово в памяти, чтобы не зависеть от порядка байт процессора
+                const uint8_t pad[2] = {*p, 0};
+                uint16_t w;
+                memcpy(&w, pad, 2);
+                acc += w;
+            }
+            return acc;
+        }
+
+        uint32_t partialScalar(const void* data, size_t length, uint32_t sum) {
+            return fold(sumScalar(static_cast<const uint8_t*>(data), length, sum));
+        }
+
+#ifdef CHECKSUM_X86
+        // Векторные реализации раскладывают каждое 32-битное слово на два 16-битных
+        // и копят их в 32-битных дорожках. За итерацию дорожка растёт не больше чем
+        // на 4 * 0xFFFF (два вектора), поэтому каждые kFlushIterations итераций
+        // дорожки переносятся в 64-битный итог, пока они не переполнились.
+        constexpr size_t kFlushIterations = 8192;
+
+        __attribute__((target("sse2")))
+        uint32_t partialSse2(const void* data, size_t length, uint32_t sum) {
+            const auto* p = static_cast<const uint8_t*>(data);
+            const __m128i low = _mm_set1_epi32(0xFFFF);
+            const __m128i zero = _mm_setzero_si128();
+            __m128i total = zero;
+            size_t iterations = length / 32;
+            while (iterations) {
+                size_t n = iterations < kFlushIterations ? iterations : kFlushIterations;
+                iterations -= n;
+                __m128i a = zero, b = zero;
+                for (; n; --n, p += 32) {
+                    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+                    a = _mm_add_epi32(a, _mm_add_epi32(_mm_and_si128(v0, low), _mm_srli_epi32(v0, 16)));
+                    b = _mm_add_epi32(b, _mm_add_epi32(_mm_and_si128(v1, low), _mm_srli_epi32(v1, 16)));
+                }
+                a = _mm_add_epi32(a, b);
+                total = _mm_add_epi64(total, _mm_unpacklo_epi32(a, zero));
+                total = _mm_add_epi64(total, _mm_unpackhi_epi32(a, zero));
+            }
+            uint64_t lanes[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), total);
+            return fold(sumScalar(p, length % 32, uint64_t(sum) + lanes[0] + lanes[1]));
+        }
+
+        __attribute__((target("avx2")))
+        uint32_t partialAvx2(const void* data, size_t length, uint32_t sum) {
+            const auto* p = static_cast<const uint8_t*>(data);
+            const __m256i low = _mm256_set1_epi32(0xFFFF);
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i total = zero;
+            size_t iterations = length / 64;
+            while (iterations) {
+                size_t n = iterations < kFlushIterations ? iterations : kFlushIterations;
+                iterations -= n;
+                __m256i a = zero, b = zero;
+                for (; n; --n, p += 64) {
+                    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+                    a = _mm256_add_epi32(a, _mm256_add_epi32(_mm256_and_si256(v0, low), _mm256_srli_epi32(v0, 16)));
+                    b = _mm256_add_epi32(b, _mm256_add_epi32(_mm256_and_si256(v1, low), _mm256_srli_epi32(v1, 16)));
+                }
+                a = _mm256_add_epi32(a, b);
+                total = _mm256_add_epi64(total, _mm256_unpacklo_epi32(a, zero));
+                total = _mm256_add_epi64(total, _mm256_unpackhi_epi32(a, zero));
+            }
+            uint64_t lanes[4];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+            uint64_t acc = uint64_t(sum) + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            return fold(sumScalar(p, length % 64, acc));
+        }
+
+        // Только варианты с обнулением по маске (maskz): в обычных формах сдвига, расширения
+        // и извлечения GCC подставляет неопределённый исходный операнд и предупреждает о нём
+        __attribute__((target("avx512f")))
+        uint32_t partialAvx512(const void* data, size_t length, uint32_t sum) {
+            const auto* p = static_cast<const uint8_t*>(data);
+            const __m512i low = _mm512_set1_epi32(0xFFFF);
+            const __m512i zero = _mm512_setzero_si512();
+            __m512i total = zero;
+            size_t iterations = length / 128;
+            while (iterations) {
+                size_t n = iterations < kFlushIterations ? iterations : kFlushIterations;
+                iterations -= n;
+                __m512i a = zero, b = zero;
+                for (; n; --n, p += 128) {
+                    __m512i v0 = _mm512_loadu_si512(p);
+                    __m512i v1 = _mm512_loadu_si512(p + 64);
+                    a = _mm512_add_epi32(a, _mm512_add_epi32(_mm512_and_si512(v0, low),
+                                                             _mm512_maskz_srli_epi32(0xFFFF, v0, 16)));
+                    b = _mm512_add_epi32(b, _mm512_add_epi32(_mm512_and_si512(v1, low),
+                                                             _mm512_maskz_srli_epi32(0xFFFF, v1, 16)));
+                }
+                a = _mm512_add_epi32(a, b);
+                __m256i lo = _mm512_maskz_extracti64x4_epi64(0xF, a, 0);
+                __m256i hi = _mm512_maskz_extracti64x4_epi64(0xF, a, 1);
+                total = _mm512_add_epi64(total, _mm512_maskz_cvtepu32_epi64(0xFF, lo));
+                total = _mm512_add_epi64(total, _mm512_maskz_cvtepu32_epi64(0xFF, hi));
+            }
+            uint64_t lanes[8];
+            _mm512_storeu_si512(lanes, total);
+            uint64_t acc = uint64_t(sum);
+            for (uint64_t lane : lanes) {
+                acc += lane;
+            }
+            return fold(sumScalar(p, length % 128, acc));
+        }
+#endif
+
+        using PartialFn = uint32_t (*)(const void*, size_t, uint32_t);
+
+        /// Короче этого блоки быстрее суммирует скалярная реализация (нет подготовки векторов)
+        constexpr size_t kVectorMinLength = 128;
+
+        PartialFn kernelFunction(ChecksumKernel kernel) {
+            switch (kernel) {
+#ifdef CHECKSUM_X86
+                case ChecksumKernel::Sse2: return partialSse2;
+                case ChecksumKernel::Avx2: return partialAvx2;
+                case ChecksumKernel::Avx512: return partialAvx512;
+#endif
+                default: return partialScalar;
+            }
+        }
+
+        ChecksumKernel selectKernel() {
+            for (ChecksumKernel kernel : {ChecksumKernel::Avx512, ChecksumKernel::Avx2, ChecksumKernel::Sse2}) {
+                if (checksumKernelSupported(kernel)) {
+                    return kernel;
+                }
+            }
+            return ChecksumKernel::Scalar;
+        }
+
+    } // namespace
+
+    bool checksumKernelSupported(ChecksumKernel kernel) {
+#ifdef CHECKSUM_X86
+        // Может вызываться из статических конструкторов, до инициализации в libgcc
+        __builtin_cpu_init();
+        switch (kernel) {
+            case ChecksumKernel::Scalar: return true;
+            case ChecksumKernel::Sse2: return __builtin_cpu_supports("sse2");
+            case ChecksumKernel::Avx2: return __builtin_cpu_supports("avx2");
+            case ChecksumKernel::Avx512: return __builtin_cpu_supports("avx512f");
+        }
+        return false;
+#else
+        return kernel == ChecksumKernel::Scalar;
+#endif
+    }
+
+    ChecksumKernel activeChecksumKernel() {
+        static const ChecksumKernel kernel = selectKernel();
+        return kernel;
+    }
+
+    const char* checksumKernelName(ChecksumKernel kernel) {
+        switch (kernel) {
+            case ChecksumKernel::Scalar: return "scalar";
+            case ChecksumKernel::Sse2: return "sse2";
+            case ChecksumKernel::Avx2: return "avx2";
+            case ChecksumKernel::Avx512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    uint32_t checksumPartial(const void* data, size_t length, uint32_t sum) {
+        static const PartialFn active = kernelFunction(activeChecksumKernel());
+        if (length < kVectorMinLength) {
+            return partialScalar(data, length, sum);
+        }
+        return active(data, length, sum);
+    }
+
+    uint32_t checksumPartial(ChecksumKernel kernel, const void* data, size_t length, uint32_t sum) {
+        return kernelFunction(kernel)(data, length, sum);
+    }
+
+} // namespace utils
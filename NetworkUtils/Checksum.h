@@ -0,0 +1,97 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils {
+
+    /**
+     * @enum ChecksumKernel
+     * @brief Реализация суммирования для контрольной суммы Интернета
+     */
+    enum class ChecksumKernel {
+        Scalar, ///< Переносимая реализация (64-битный аккумулятор)
+        Sse2,   ///< 128-битные векторы SSE2
+        Avx2,   ///< 256-битные векторы AVX2
+        Avx512  ///< 512-битные векторы AVX-512F
+    };
+
+    /**
+     * @brief Частичная сумма RFC 1071 для блока данных
+     * @param data Начало блока
+     * @param length Длина блока в байтах
+     * @param sum Частичная сумма предыдущих блоков (0 для первого блока)
+     * @return Частичная сумма, свёрнутая до 16 бит (без инверсии)
+     *
+     * Слова суммируются в порядке байт процессора, поэтому результат, записанный
+     * в пакет как есть, уже имеет сетевой порядок. Нечётный последний байт
+     * дополняется нулём справа, как того требует RFC 1071, на любом порядке байт.
+     * Блоки можно суммировать по частям, но все блоки, кроме последнего,
+     * должны иметь чётную длину.
+     * Реализация выбирается один раз по возможностям процессора (см. activeChecksumKernel()),
+     * короткие блоки всегда суммируются скалярно.
+     */
+    uint32_t checksumPartial(const void* data, size_t length, uint32_t sum = 0);
+
+    /**
+     * @brief То же, что checksumPartial(), но заданной реализацией
+     * @note Реализацию, которую процессор не поддерживает, вызывать нельзя
+     *       (см. checksumKernelSupported())
+     */
+    uint32_t checksumPartial(ChecksumKernel kernel, const void* data, size_t length, uint32_t sum = 0);
+
+    /**
+     * @brief Завершает вычисление: сворачивает частичную сумму и инвертирует её
+     * @param sum Частичная сумма
+     * @return Контрольная сумма для записи в заголовок
+     */
+    inline uint16_t checksumFinish(uint32_t sum) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        return static_cast<uint16_t>(~sum);
+    }
+
+    /**
+     * @brief Контрольная сумма Интернета (RFC 1071) для блока данных
+     * @param data Начало блока
+     * @param length Длина блока в байтах
+     * @return Контрольная сумма в порядке байт пакета
+     */
+    inline uint16_t checksum(const void* data, size_t length) {
+        return checksumFinish(checksumPartial(data, length));
+    }
+
+    /**
+     * @brief Проверяет, поддерживает ли процессор реализацию
+     */
+    bool checksumKernelSupported(ChecksumKernel kernel);
+
+    /**
+     * @brief Реализация, выбранная для checksumPartial()
+     */
+    ChecksumKernel activeChecksumKernel();
+
+    /**
+     * @brief Название реализации ("scalar", "sse2", "avx2", "avx512")
+     */
+    const char* checksumKernelName(ChecksumKernel kernel);
+
+    /**
+     * @brief Инкрементально обновляет контрольную сумму Интернета (RFC 1624, формула 3)
+     * @param checksum Текущая контрольная сумма
+     * @param oldWord Прежнее значение изменённого 16-битного слова
+     * @param newWord Новое значение слова
+     * @return Контрольная сумма после замены слова
+     *
+     * Сумма в обратном коде не зависит от порядка байт, поэтому все три значения
+     * можно передавать в том виде, в котором они лежат в пакете (сетевой порядок).
+     */
+    inline uint16_t checksumUpdate(uint16_t checksum, uint16_t oldWord, uint16_t newWord) {
+        uint32_t sum = uint32_t(uint16_t(~checksum)) + uint16_t(~oldWord) + newWord;
+        return checksumFinish(sum);
+    }
+
+} // namespace utils
+
+#endif // CHECKSUM_H
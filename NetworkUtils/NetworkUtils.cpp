@@ -55,6 +55,12 @@ namespace utils {
         return std::string(buf);
     }
 
+    std::string macToString(uint64_t mac) {
+        uint8_t bytes[6];
+        u64ToMac(mac, bytes);
+        return macToString(bytes);
+    }
+
     std::string ipToString(uint32_t ip) {
         struct in_addr addr;
         addr.s_addr = ip;
@@ -65,5 +71,16 @@ namespace utils {
         return std::string(ipStr);
     }
 
+    bool isLinkUp(const std::string &iface) {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct ifreq ifr{};
+        strncpy(ifr.ifr_name, iface.c_str(), IFNAMSIZ - 1);
+        bool up = ioctl(fd, SIOCGIFFLAGS, &ifr) == 0 && (ifr.ifr_flags & IFF_UP) && (ifr.ifr_flags & IFF_RUNNING);
+        close(fd);
+        return up;
+    }
 
 } // namespace utils
\ No newline at end of file
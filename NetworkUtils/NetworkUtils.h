@@ -10,6 +10,36 @@ namespace utils {
     void printInterfaces(const std::vector<std::string>& interfaces);
     std::string ipToString(uint32_t ip);
     std::string macToString(const uint8_t* mac);
+    std::string macToString(uint64_t mac);
+
+    /**
+     * @brief Работает ли канал интерфейса: интерфейс включён и есть несущая (IFF_UP и IFF_RUNNING)
+     * @param iface Имя интерфейса
+     * @return false, если интерфейс выключен, без несущей или не найден
+     */
+    bool isLinkUp(const std::string& iface);
+
+    /**
+     * @brief Упаковывает 48-битный MAC-адрес в младшие байты uint64_t
+     * @param mac Указатель на 6 байт MAC-адреса
+     * @return MAC-адрес в виде целого числа (старший байт адреса — старший байт результата)
+     */
+    inline uint64_t macToU64(const uint8_t* mac) {
+        return (uint64_t(mac[0]) << 40) | (uint64_t(mac[1]) << 32) | (uint64_t(mac[2]) << 24) |
+               (uint64_t(mac[3]) << 16) | (uint64_t(mac[4]) << 8) | uint64_t(mac[5]);
+    }
+
+    /**
+     * @brief Распаковывает MAC-адрес, упакованный macToU64
+     * @param value Упакованный MAC-адрес
+     * @param mac Буфер на 6 байт для результата
+     */
+    inline void u64ToMac(uint64_t value, uint8_t* mac) {
+        for (int i = 5; i >= 0; --i) {
+            mac[i] = static_cast<uint8_t>(value);
+            value >>= 8;
+        }
+    }
 
 } // namespace utils
 
@@ -0,0 +1,36 @@
+#include "PcapCapture.h"
+
+namespace utils {
+
+    pcap_t* openCapture(const std::string& iface, const CaptureOptions& options, char* errbuf) {
+        pcap_t* handle = pcap_create(iface.c_str(), errbuf);
+        if (!handle) {
+            return nullptr;
+        }
+
+        pcap_set_snaplen(handle, options.snaplen);
+        pcap_set_promisc(handle, options.promisc ? 1 : 0);
+        pcap_set_timeout(handle, options.timeoutMs);
+        pcap_set_buffer_size(handle, options.bufferSize);
+        pcap_set_immediate_mode(handle, options.immediate ? 1 : 0);
+        if (options.nanoTimestamps &&
+            pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO) != 0) {
+            std::cerr << "Nanosecond timestamps are not supported on " << iface
+                      << ", using microseconds" << std::endl;
+        }
+
+        int status = pcap_activate(handle);
+        if (status < 0) {
+            // Для PCAP_ERROR подробности в pcap_geterr, для остальных кодов — в pcap_statustostr
+            std::string message = status == PCAP_ERROR ? pcap_geterr(handle) : pcap_statustostr(status);
+            snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", message.c_str());
+            pcap_close(handle);
+            return nullptr;
+        }
+        if (status > 0) {
+            std::cerr << "Warning on " << iface << ": " << pcap_statustostr(status) << std::endl;
+        }
+        return handle;
+    }
+
+} // namespace utils
@@ -0,0 +1,35 @@
+#ifndef PCAP_CAPTURE_H
+#define PCAP_CAPTURE_H
+
+#include "Headers.h"
+
+namespace utils {
+
+    /**
+     * @struct CaptureOptions
+     * @brief Параметры дескриптора захвата libpcap
+     */
+    struct CaptureOptions {
+        int snaplen = 65535;              ///< Максимум байт кадра (с запасом для jumbo-кадров 9000 байт)
+        int bufferSize = 4 * 1024 * 1024; ///< Размер буфера ядра, байт
+        bool immediate = true;            ///< Отдавать кадры сразу, не дожидаясь заполнения буфера
+        int timeoutMs = 10;               ///< Тайм-аут чтения, мс (без immediate — задержка выдачи буфера)
+        bool nanoTimestamps = false;      ///< Метки времени в наносекундах (в ts.tv_usec)
+        bool promisc = true;              ///< Неразборчивый режим
+    };
+
+    /**
+     * @brief Открывает интерфейс через pcap_create() с заданными параметрами
+     * @param iface Имя интерфейса
+     * @param options Параметры захвата
+     * @param errbuf Буфер на PCAP_ERRBUF_SIZE байт для текста ошибки
+     * @return Активированный дескриптор или nullptr (текст ошибки в errbuf)
+     *
+     * Предупреждения pcap_activate() и неподдерживаемая точность меток времени
+     * выводятся в std::cerr, дескриптор при этом открывается.
+     */
+    pcap_t* openCapture(const std::string& iface, const CaptureOptions& options, char* errbuf);
+
+} // namespace utils
+
+#endif // PCAP_CAPTURE_H
@@ -1,4 +1,5 @@
 #include "PacketProcessor.h"
+#include "PcapCapture.h"
 
 
 int main(int argc, char* argv[]) {
@@ -36,7 +37,8 @@ int main(int argc, char* argv[]) {
         selectedInterface = d->name;
     }
 
-    pcap_t* handle = pcap_open_live(selectedInterface.c_str(), BUFSIZ, 1, 1000, errbuf);
+    // Кадры выводятся по мере приёма, целиком (и jumbo-кадры)
+    pcap_t* handle = utils::openCapture(selectedInterface, utils::CaptureOptions{}, errbuf);
     if (!handle) {
         std::cerr << "Couldn't open interface " << selectedInterface << ": " << errbuf << std::endl;
         pcap_freealldevs(alldevs);